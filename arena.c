@@ -0,0 +1,142 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:08:34 PDT 2026
+// Last Modified: Thu Oct 15 20:08:34 PDT 2026
+// Filename:      arena.c
+// Syntax:        C
+//
+// Description:   Arena allocator for the temporary storage of items
+//                while converting a file.  Memory is taken from large
+//                blocks, and all of it is released at once with
+//                resetArena() after each item, so that items of any
+//                length can be converted without a heap allocation
+//                for each item.
+//
+
+#include <stdlib.h>
+
+#include "arena.h"
+
+// Allocations are aligned for any data type (including SIMD vectors):
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct ArenaBlock {
+	ArenaBlock* next;
+	size_t      size;    // number of bytes of data in the block
+	size_t      used;    // number of bytes already allocated
+};
+
+#define ARENA_HEADER ARENA_ROUND(sizeof(ArenaBlock))
+
+// function declarations:
+static ArenaBlock* addArenaBlock  (Arena* arena, size_t size);
+
+
+
+//////////////////////////////
+//
+// initArena -- Prepare an arena with an initial block of the given size
+//    (which may be zero to allocate nothing until the first request).
+//
+
+void initArena(Arena* arena, size_t size) {
+	arena->blocks = NULL;
+	arena->total  = 0;
+	if (size > 0) {
+		addArenaBlock(arena, ARENA_ROUND(size));
+	}
+}
+
+
+
+//////////////////////////////
+//
+// allocateArena -- Return size bytes of memory from the arena.  A new
+//    block (at least double the size of the previous one) is added if
+//    the current block is full.  Returns NULL if out of memory.
+//
+
+void* allocateArena(Arena* arena, size_t size) {
+	ArenaBlock* block = arena->blocks;
+	size = ARENA_ROUND(size);
+	if ((block == NULL) || (block->size - block->used < size)) {
+		size_t blockSize = block ? 2 * block->size : 4096;
+		if (blockSize < size) {
+			blockSize = size;
+		}
+		block = addArenaBlock(arena, blockSize);
+		if (block == NULL) {
+			return NULL;
+		}
+	}
+	void* pointer = (unsigned char*)block + ARENA_HEADER + block->used;
+	block->used += size;
+	return pointer;
+}
+
+
+
+//////////////////////////////
+//
+// resetArena -- Release all memory allocated from the arena.  If the
+//    arena had to grow, the blocks are replaced by one block of the
+//    total size, so that the next item of the same size fits without
+//    adding a block.
+//
+
+void resetArena(Arena* arena) {
+	ArenaBlock* block = arena->blocks;
+	if (block == NULL) {
+		return;
+	}
+	if (block->next == NULL) {
+		block->used = 0;
+		return;
+	}
+	size_t total = arena->total;
+	freeArena(arena);
+	addArenaBlock(arena, total);
+}
+
+
+
+//////////////////////////////
+//
+// freeArena -- Return the memory of the arena to the system.
+//
+
+void freeArena(Arena* arena) {
+	ArenaBlock* block = arena->blocks;
+	while (block != NULL) {
+		ArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	arena->blocks = NULL;
+	arena->total  = 0;
+}
+
+
+
+//////////////////////////////
+//
+// addArenaBlock -- Allocate a new block for the arena and make it the
+//    current block.
+//
+
+static ArenaBlock* addArenaBlock(Arena* arena, size_t size) {
+	ArenaBlock* block = (ArenaBlock*)malloc(ARENA_HEADER + size);
+	if (block == NULL) {
+		return NULL;
+	}
+	block->next   = arena->blocks;
+	block->size   = size;
+	block->used   = 0;
+	arena->blocks = block;
+	arena->total += size;
+	return block;
+}
+
+
+
@@ -0,0 +1,33 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:08:34 PDT 2026
+// Last Modified: Thu Oct 15 20:08:34 PDT 2026
+// Filename:      arena.h
+// Syntax:        C
+//
+// Description:   Arena allocator for the temporary storage of items
+//                while converting a file.  Memory is taken from large
+//                blocks, and all of it is released at once with
+//                resetArena() after each item, so that items of any
+//                length can be converted without a heap allocation
+//                for each item.
+//
+
+#ifndef _ARENA_H_INCLUDED
+#define _ARENA_H_INCLUDED
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+	ArenaBlock* blocks;   // most recently added block first
+	size_t      total;    // sum of the sizes of the blocks
+} Arena;
+
+void     initArena      (Arena* arena, size_t size);
+void*    allocateArena  (Arena* arena, size_t size);
+void     resetArena     (Arena* arena);
+void     freeArena      (Arena* arena);
+
+#endif  /* _ARENA_H_INCLUDED */
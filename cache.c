@@ -0,0 +1,434 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:38:08 PDT 2026
+// Last Modified: Thu Oct 15 20:38:08 PDT 2026
+// Filename:      cache.c
+// Syntax:        C
+//
+// Description:   Incremental conversion cache (see cache.h).  The manifest
+//                is read into a sorted list at the start of a run.  The
+//                threads of a batch look up their output files in this
+//                list (marking the entries which they replace under the
+//                cache lock), and store the entries for the files which
+//                they convert in a separate list by the index of the
+//                file.  The two lists are merged when the
+//                manifest is saved, which replaces the manifest file at
+//                the end of the run.
+//
+//                Manifest lines contain tab-separated fields: the input
+//                hash and the options hash (as 16 hex digits), the output
+//                size and modification time, and the output filename.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+// Constants for hashCacheData() (from xxHash64):
+#define HASH_PRIME1 0x9e3779b185ebca87ULL
+#define HASH_PRIME2 0xc2b2ae3d27d4eb4fULL
+#define HASH_PRIME3 0x165667b19e3779f9ULL
+
+// function declarations:
+static int      readManifestLine    (FILE* file, char** line,
+                                     size_t* capacity);
+static int      parseManifestLine   (char* line, CacheEntry* entry);
+static int      compareCacheEntries (const void* a, const void* b);
+static int      isUnchangedOutput   (const CacheEntry* entry);
+static void     writeManifestLine   (FILE* file, const CacheEntry* entry);
+static uint64_t rotateLeft          (uint64_t value, int bits);
+
+
+
+//////////////////////////////
+//
+// openConversionCache -- Read the manifest file (if it exists) for a run
+//    with the given number of files.  options describes the conversion
+//    (the program, library version and settings which change the
+//    output), and only entries for the same options are used.  An
+//    unreadable manifest is treated as an empty one.  Returns 0 if
+//    successful, or -1 if out of memory.
+//
+
+int openConversionCache(ConversionCache* cache, const char* filename,
+		const char* options, int files) {
+	memset(cache, 0, sizeof(ConversionCache));
+	cache->filename    = filename;
+	cache->options     = hashCacheData(options, strlen(options));
+	cache->resultCount = files;
+	cache->results     = (CacheEntry*)calloc(files + 1, sizeof(CacheEntry));
+	pthread_mutex_init(&cache->mutex, NULL);
+	if (cache->results == NULL) {
+		return -1;
+	}
+
+	FILE* file = fopen(filename, "r");
+	if (file == NULL) {
+		return 0;
+	}
+	char*      line     = NULL;
+	size_t     length   = 0;
+	int        capacity = 0;
+	int        status   = readManifestLine(file, &line, &length);
+	CacheEntry entry;
+	if (status < 0) {
+		free(line);
+		fclose(file);
+		return -1;
+	}
+	if ((status == 0) ||
+			(strcspn(line, "\r\n") != strlen(CACHE_MANIFEST_HEADER)) ||
+			(strncmp(line, CACHE_MANIFEST_HEADER,
+			strlen(CACHE_MANIFEST_HEADER)) != 0)) {
+		// Not a manifest, so it is replaced when the cache is saved.
+		free(line);
+		fclose(file);
+		return 0;
+	}
+	while ((status = readManifestLine(file, &line, &length)) > 0) {
+		if (parseManifestLine(line, &entry) != 0) {
+			continue;
+		}
+		if (cache->count == capacity) {
+			capacity = capacity ? 2 * capacity : 1024;
+			CacheEntry* larger = (CacheEntry*)realloc(cache->entries,
+					capacity * sizeof(CacheEntry));
+			if (larger == NULL) {
+				status = -1;
+				break;
+			}
+			cache->entries = larger;
+		}
+		entry.output = strdup(entry.output);
+		if (entry.output == NULL) {
+			status = -1;
+			break;
+		}
+		cache->entries[cache->count++] = entry;
+	}
+	free(line);
+	fclose(file);
+	if (cache->count > 1) {
+		qsort(cache->entries, cache->count, sizeof(CacheEntry),
+				compareCacheEntries);
+	}
+	return (status < 0) ? -1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkCacheEntry -- Returns true if the output file of the file with
+//    the given index in the run is up to date: the manifest contains an
+//    entry for it with the same input hash and options, and the output
+//    file has not changed since then.  Counts a hit or a miss, and can
+//    be called from any thread.
+//
+
+int checkCacheEntry(ConversionCache* cache, int index, const char* output,
+		uint64_t hash) {
+	CacheEntry  key;
+	CacheEntry* entry = NULL;
+	int         hit   = 0;
+	key.output = (char*)output;
+	if (cache->count > 0) {
+		entry = (CacheEntry*)bsearch(&key, cache->entries, cache->count,
+				sizeof(CacheEntry), compareCacheEntries);
+	}
+	if (entry != NULL) {
+		hit = (entry->hash == hash) && (entry->options == cache->options) &&
+				isUnchangedOutput(entry);
+	}
+	if (hit) {
+		cache->results[index]        = *entry;
+		cache->results[index].output = strdup(output);
+	}
+
+	pthread_mutex_lock(&cache->mutex);
+	if (entry != NULL) {
+		// The entry is replaced by the result of this run.
+		entry->used = index + 1;
+	}
+	if (hit) {
+		cache->hits++;
+	} else {
+		cache->misses++;
+	}
+	pthread_mutex_unlock(&cache->mutex);
+	return hit;
+}
+
+
+
+//////////////////////////////
+//
+// storeCacheEntry -- Store the entry for an output file which was
+//    written successfully from input with the given hash.
+//
+
+void storeCacheEntry(ConversionCache* cache, int index, const char* output,
+		uint64_t hash) {
+	struct stat info;
+	if ((strchr(output, '\n') != NULL) || (stat(output, &info) != 0)) {
+		// A newline in the filename cannot be stored in the manifest.
+		return;
+	}
+	CacheEntry* entry = &cache->results[index];
+	entry->output  = strdup(output);
+	entry->hash    = hash;
+	entry->options = cache->options;
+	entry->size    = (long long)info.st_size;
+	entry->mtime   = (long long)info.st_mtime;
+}
+
+
+
+//////////////////////////////
+//
+// saveConversionCache -- Write the manifest with the entries of this
+//    run and the entries of other output files which are still
+//    unchanged.  The other entries are evicted, as are the entries of
+//    files of this run which have no result (because their conversion
+//    failed).  The manifest is
+//    written to a temporary file which then replaces the old manifest.
+//    Returns 0 if successful.
+//
+
+int saveConversionCache(ConversionCache* cache) {
+	size_t length    = strlen(cache->filename) + 8;
+	char*  temporary = (char*)malloc(length);
+	if (temporary == NULL) {
+		fprintf(stderr, "Error: out of memory for cache manifest\n");
+		return -1;
+	}
+	snprintf(temporary, length, "%s.tmp", cache->filename);
+	FILE* file = fopen(temporary, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for writing.\n", temporary);
+		free(temporary);
+		return -1;
+	}
+
+	fprintf(file, "%s\n", CACHE_MANIFEST_HEADER);
+	int i;
+	for (i=0; i<cache->count; i++) {
+		if (cache->entries[i].used) {
+			if (cache->results[cache->entries[i].used - 1].output == NULL) {
+				cache->evicted++;
+			}
+			continue;
+		}
+		if (isUnchangedOutput(&cache->entries[i])) {
+			writeManifestLine(file, &cache->entries[i]);
+		} else {
+			cache->evicted++;
+		}
+	}
+	for (i=0; i<cache->resultCount; i++) {
+		if (cache->results[i].output != NULL) {
+			writeManifestLine(file, &cache->results[i]);
+		}
+	}
+
+	int status = 0;
+	if (fclose(file) != 0) {
+		fprintf(stderr, "Error: cannot write file %s.\n", temporary);
+		remove(temporary);
+		status = -1;
+	} else if (rename(temporary, cache->filename) != 0) {
+		fprintf(stderr, "Error: cannot replace file %s.\n", cache->filename);
+		remove(temporary);
+		status = -1;
+	}
+	free(temporary);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// freeConversionCache -- Free the memory used by the cache.
+//
+
+void freeConversionCache(ConversionCache* cache) {
+	int i;
+	for (i=0; i<cache->count; i++) {
+		free(cache->entries[i].output);
+	}
+	for (i=0; i<cache->resultCount; i++) {
+		free(cache->results[i].output);
+	}
+	free(cache->entries);
+	free(cache->results);
+	cache->entries = NULL;
+	cache->results = NULL;
+	cache->count   = 0;
+	pthread_mutex_destroy(&cache->mutex);
+}
+
+
+
+//////////////////////////////
+//
+// hashCacheData -- Return a 64-bit hash of the data.  The words are
+//    mixed in the same way as in one lane of xxHash64 (the result is
+//    not the same as xxHash64).  The words are read in the byte order
+//    of the computer, so a manifest should not be shared between
+//    computers with different byte orders.
+//
+
+uint64_t hashCacheData(const void* data, size_t size) {
+	const unsigned char* ptr = (const unsigned char*)data;
+	const unsigned char* end = ptr + size;
+	uint64_t hash = HASH_PRIME3 + (uint64_t)size;
+	uint64_t word;
+	while (end - ptr >= 8) {
+		memcpy(&word, ptr, 8);
+		hash ^= rotateLeft(word * HASH_PRIME2, 31) * HASH_PRIME1;
+		hash  = rotateLeft(hash, 27) * HASH_PRIME1 + HASH_PRIME3;
+		ptr  += 8;
+	}
+	while (ptr < end) {
+		hash ^= *ptr++ * HASH_PRIME3;
+		hash  = rotateLeft(hash, 11) * HASH_PRIME1;
+	}
+	hash ^= hash >> 33;
+	hash *= HASH_PRIME2;
+	hash ^= hash >> 29;
+	hash *= HASH_PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+
+
+//////////////////////////////
+//
+// readManifestLine -- Read the next line of the manifest (including its
+//    newline) into line, which is enlarged as needed.  Its size is
+//    stored in capacity.  Returns 1 if a line was read, 0 at the end of
+//    the file, or -1 if out of memory.
+//
+
+static int readManifestLine(FILE* file, char** line, size_t* capacity) {
+	size_t length = 0;
+	while (1) {
+		if (*capacity - length < 2) {
+			size_t larger = *capacity ? 2 * *capacity : 256;
+			char*  buffer = (char*)realloc(*line, larger);
+			if (buffer == NULL) {
+				return -1;
+			}
+			*line     = buffer;
+			*capacity = larger;
+		}
+		if (fgets(*line + length, (int)(*capacity - length), file) == NULL) {
+			return (length > 0) ? 1 : 0;
+		}
+		length += strlen(*line + length);
+		if ((length > 0) && ((*line)[length - 1] == '\n')) {
+			return 1;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// parseManifestLine -- Read the fields of a manifest line into an
+//    entry.  The output filename points into the line, which is
+//    modified.  Returns 0 if successful, or -1 if the line is invalid.
+//
+
+static int parseManifestLine(char* line, CacheEntry* entry) {
+	char* ptr = line;
+	char* next;
+	memset(entry, 0, sizeof(CacheEntry));
+	entry->hash = strtoull(ptr, &next, 16);
+	if ((next == ptr) || (*next != '\t')) {
+		return -1;
+	}
+	ptr = next + 1;
+	entry->options = strtoull(ptr, &next, 16);
+	if ((next == ptr) || (*next != '\t')) {
+		return -1;
+	}
+	ptr = next + 1;
+	entry->size = strtoll(ptr, &next, 10);
+	if ((next == ptr) || (*next != '\t')) {
+		return -1;
+	}
+	ptr = next + 1;
+	entry->mtime = strtoll(ptr, &next, 10);
+	if ((next == ptr) || (*next != '\t')) {
+		return -1;
+	}
+	entry->output = next + 1;
+	next = entry->output + strlen(entry->output);
+	while ((next > entry->output) && ((next[-1] == '\n') ||
+			(next[-1] == '\r'))) {
+		*--next = '\0';
+	}
+	return (*entry->output == '\0') ? -1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// compareCacheEntries -- Sort entries by their output filenames.
+//
+
+static int compareCacheEntries(const void* a, const void* b) {
+	return strcmp(((const CacheEntry*)a)->output,
+			((const CacheEntry*)b)->output);
+}
+
+
+
+//////////////////////////////
+//
+// isUnchangedOutput -- Returns true if the output file of an entry
+//    still has the size and modification time stored in the entry.
+//
+
+static int isUnchangedOutput(const CacheEntry* entry) {
+	struct stat info;
+	return (stat(entry->output, &info) == 0) &&
+			((long long)info.st_size == entry->size) &&
+			((long long)info.st_mtime == entry->mtime);
+}
+
+
+
+//////////////////////////////
+//
+// writeManifestLine -- Write an entry as a line of the manifest.
+//
+
+static void writeManifestLine(FILE* file, const CacheEntry* entry) {
+	fprintf(file, "%016llx\t%016llx\t%lld\t%lld\t%s\n",
+			(unsigned long long)entry->hash,
+			(unsigned long long)entry->options, entry->size, entry->mtime,
+			entry->output);
+}
+
+
+
+//////////////////////////////
+//
+// rotateLeft -- Rotate the bits of a 64-bit number.
+//
+
+static uint64_t rotateLeft(uint64_t value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+
+
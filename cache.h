@@ -0,0 +1,66 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:38:08 PDT 2026
+// Last Modified: Thu Oct 15 20:38:08 PDT 2026
+// Filename:      cache.h
+// Syntax:        C
+//
+// Description:   Incremental conversion cache for the --cache option of
+//                the batch modes of mus2pmx and pmx2mus.  A manifest file
+//                stores a line for each output file which was written:
+//                a hash of the input data, a hash of the converter
+//                version and options, and the size and modification
+//                time of the output file.  An input is not converted
+//                again if both hashes are the same and the output file
+//                has not changed since it was written.  When the manifest
+//                is saved, entries for output files which were removed or
+//                changed by something else are evicted.
+//
+//                The output filenames are stored as given, so a cache
+//                should be used from the same directory each time.
+//
+
+#ifndef _CACHE_H_INCLUDED
+#define _CACHE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// First line of a manifest file (other manifests are ignored):
+#define CACHE_MANIFEST_HEADER "#score-cache 1"
+
+typedef struct {
+	char*     output;    // output filename
+	uint64_t  hash;      // hash of the input data
+	uint64_t  options;   // hash of the converter version and options
+	long long size;      // size of the output file
+	long long mtime;     // modification time of the output file
+	int       used;      // 1 + index of the file of this run with the
+	                     // same output file, or 0
+} CacheEntry;
+
+typedef struct {
+	const char*     filename;   // manifest file
+	uint64_t        options;
+	CacheEntry*     entries;    // entries of the manifest, sorted by output
+	int             count;
+	CacheEntry*     results;    // entries for the files of this run
+	int             resultCount;
+	int             hits;
+	int             misses;
+	int             evicted;
+	pthread_mutex_t mutex;
+} ConversionCache;
+
+int      openConversionCache  (ConversionCache* cache, const char* filename,
+                               const char* options, int files);
+int      checkCacheEntry      (ConversionCache* cache, int index,
+                               const char* output, uint64_t hash);
+void     storeCacheEntry      (ConversionCache* cache, int index,
+                               const char* output, uint64_t hash);
+int      saveConversionCache  (ConversionCache* cache);
+void     freeConversionCache  (ConversionCache* cache);
+uint64_t hashCacheData        (const void* data, size_t size);
+
+#endif  /* _CACHE_H_INCLUDED */
@@ -0,0 +1,135 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:46:35 PDT 2026
+// Last Modified: Thu Oct 15 20:46:35 PDT 2026
+// Last Modified: Thu Oct 15 20:49:19 PDT 2026 added chunk functions
+// Filename:      mus2pmx-loader.js
+// Syntax:        JavaScript
+//
+// Description:   Load the fastest version of mus2pmx which the browser
+//                (or Node.js) can run: mus2pmx-simd.js (compiled with
+//                SIMD128 and threads by "make simd") if WebAssembly SIMD
+//                and shared memory are available, otherwise mus2pmx.wasm.
+//                Both versions are returned as an object with the same
+//                functions as the exports of mus2pmx.wasm, so the code
+//                which uses it does not depend on the version, and the
+//                build property is "simd" or "scalar".
+//
+//                The memory of the SIMD version is a SharedArrayBuffer,
+//                which TextDecoder cannot decode in browsers, so copy the
+//                output with slice() before decoding it.
+//
+// Usage:         const mus2pmx = await loadMus2pmx({
+//                   wasm:       bytes of mus2pmx.wasm,
+//                   createSimd: createMus2pmxSimd (from mus2pmx-simd.js,
+//                               optional),
+//                   build:      "auto" (default), "scalar" or "simd"
+//                });
+//                mus2pmx.convertMusToPmx(ptr, length);
+//
+
+"use strict";
+
+// Smallest modules with a SIMD128 instruction and with shared memory and
+// an atomic instruction, which only validate if they are supported:
+const WASM_SIMD_TEST = new Uint8Array([
+	0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10,
+	1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+const WASM_THREADS_TEST = new Uint8Array([
+	0, 97, 115, 109, 1, 0, 0, 0, 1, 4, 1, 96, 0, 0, 3, 2, 1, 0, 5, 4, 1, 3,
+	1, 1, 10, 11, 1, 9, 0, 65, 0, 254, 16, 2, 0, 26, 11
+]);
+
+
+//////////////////////////////
+//
+// hasWasmSimd -- Returns true if WebAssembly SIMD128 is supported.
+//
+
+function hasWasmSimd() {
+	return WebAssembly.validate(WASM_SIMD_TEST);
+}
+
+
+//////////////////////////////
+//
+// hasWasmThreads -- Returns true if WebAssembly threads can be used:
+//    atomic instructions are supported, and SharedArrayBuffer is
+//    available (browsers only allow it on cross-origin isolated pages).
+//
+
+function hasWasmThreads() {
+	if (typeof SharedArrayBuffer === "undefined") {
+		return false;
+	}
+	if ((typeof crossOriginIsolated !== "undefined") && !crossOriginIsolated) {
+		return false;
+	}
+	return WebAssembly.validate(WASM_THREADS_TEST);
+}
+
+
+//////////////////////////////
+//
+// loadMus2pmx -- Load the SIMD version if options.createSimd is given
+//    and the features which it needs are supported (or if options.build
+//    is "simd", which fails if they are not), otherwise mus2pmx.wasm from
+//    the bytes in options.wasm.
+//
+
+async function loadMus2pmx(options) {
+	const build = options.build || "auto";
+	const simd = options.createSimd && hasWasmSimd() && hasWasmThreads();
+	if ((build === "simd") || ((build === "auto") && simd)) {
+		if (!simd) {
+			throw new Error("mus2pmx-simd is not supported here");
+		}
+		return wrapSimdModule(await options.createSimd());
+	}
+
+	const compiled = await WebAssembly.compile(options.wasm);
+	const imports = {};
+	for (const entry of WebAssembly.Module.imports(compiled)) {
+		// Imported functions (such as WASI calls) are not used by the
+		// conversions.
+		if (entry.kind === "function") {
+			imports[entry.module] = imports[entry.module] || {};
+			imports[entry.module][entry.name] = () => 0;
+		}
+	}
+	const instance = await WebAssembly.instantiate(compiled, imports);
+	if (instance.exports._initialize) {
+		instance.exports._initialize();
+	}
+	return Object.assign({ build: "scalar" }, instance.exports);
+}
+
+
+//////////////////////////////
+//
+// wrapSimdModule -- Give the Emscripten module of mus2pmx-simd.js the
+//    same functions as the exports of mus2pmx.wasm.  memory.buffer is
+//    read again each time, since it changes when the memory grows.
+//
+
+function wrapSimdModule(simdModule) {
+	return {
+		build:                "simd",
+		convertMusToPmx:      simdModule._convertMusToPmx,
+		getPmxOutput:         simdModule._getPmxOutput,
+		getPmxOutputLength:   simdModule._getPmxOutputLength,
+		convertMusFilesToPmx: simdModule._convertMusFilesToPmx,
+		beginConversion:      simdModule._beginConversion,
+		nextChunk:            simdModule._nextChunk,
+		malloc:               simdModule._malloc,
+		free:                 simdModule._free,
+		memory:               simdModule.wasmMemory
+		                      || { get buffer() { return simdModule.HEAPU8.buffer; } }
+	};
+}
+
+
+if ((typeof module !== "undefined") && module.exports) {
+	module.exports = { loadMus2pmx, hasWasmSimd, hasWasmThreads };
+}
@@ -3,40 +3,128 @@
 // Creation Date: Wed Aug 29 13:50:35 PDT 2012
 // Last Modified: Fri Feb 22 03:54:54 PST 2013 added EPS graphic item
 // Last Modified: Mon Mar 15 18:50:16 PDT 2021 added SCORE v3 file parsing
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026 decode parameters in blocks
+// Last Modified: Thu Oct 15 20:08:34 PDT 2026 no limit on text length
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026 conversion done by libscore
+// Last Modified: Thu Oct 15 20:38:55 PDT 2026 growable output buffer
+// Last Modified: Thu Oct 15 20:40:07 PDT 2026 convert many files in one call
+// Last Modified: Thu Oct 15 20:46:35 PDT 2026 threads for convertMusFilesToPmx
+// Last Modified: Thu Oct 15 20:49:19 PDT 2026 conversion in chunks
 // Filename:      mus2pmx.c
 // Syntax:        C; Emscripten
 // vim:           ts=3:nowrap
 //
 // Description:   Emscripten version of the mus2pmx program for JavaScript that converts
 //                binary SCORE files into ASCII (PMX) files.  Binary SCORE data files
-//                typically end in the extensions .mus or .pag.
+//                typically end in the extensions .mus or .pag.  The
+//                conversion is done by libscore (../libscore.h), the same
+//                as in the command-line version of mus2pmx.
+//
+//                The output buffer grows as needed (doubling its size), so
+//                large WinSCORE files are not truncated.  It is kept for
+//                the next conversion, and is not cleared: the text is
+//                terminated by a null character, and getPmxOutputLength()
+//                returns its length, so that JavaScript can create a view
+//                of the output in the wasm memory without searching for
+//                the null character.
+//
+//                convertMusFilesToPmx() converts many files which are
+//                stored in one allocation of wasm memory in a single call,
+//                with the pages separated by ##FILE: and ##PAGEBREAK lines
+//                in the same way as the output of mus2pmx for multiple
+//                input files.  It returns a table with the position of the
+//                PMX text of each file in the output buffer.
+//
+//                beginConversion() and nextChunk() convert a file in
+//                chunks of complete lines of PMX text, so that JavaScript
+//                can use the first lines of a large file before the rest
+//                is converted.  Only the text of the next items is
+//                converted for each chunk, so the memory used for the
+//                output does not depend on the size of the file.
+//
+//                In the SIMD build (mus2pmx-simd.js, compiled with
+//                -pthread, see the Makefile), convertMusFilesToPmx()
+//                converts the files with up to WASM_THREADS threads
+//                into separate buffers, which are then copied into the
+//                output buffer in the order of the files, so the output
+//                is the same as in the single-threaded build.
 //
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
-#include <stdarg.h>
+#include <stdint.h>
 #include <emscripten.h>
+#ifdef __EMSCRIPTEN_PTHREADS__
+	#include <pthread.h>
+	#include <emscripten/threading.h>
+#endif
 
-// Global buffer for storing the PMX output data:
+#include "../libscore.h"
+
+// Initial size of the buffer for the PMX output data:
 #define PMX_BUFFER_SIZE 65536
-char pmx_output[PMX_BUFFER_SIZE];
-size_t pmx_index = 0;
 
-int debugQ = 0;
+// Maximum number of threads for convertMusFilesToPmx() in the SIMD build
+// (the Makefile uses the same number for the size of the thread pool):
+#ifndef WASM_THREADS
+	#define WASM_THREADS 4
+#endif
+
+// Buffer for PMX output text:
+typedef struct {
+	char*  text;
+	size_t length;     // length of the text
+	size_t capacity;   // allocated size of text
+} PmxBuffer;
+
+// Global buffer for storing the PMX output data:
+PmxBuffer pmx_output = { NULL, 0, 0 };
+
+// Offset and length of the PMX text of each file of convertMusFilesToPmx():
+uint32_t* pmx_records        = NULL;
+int       pmx_recordCapacity = 0;   // number of files with space in pmx_records
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+// Files of convertMusFilesToPmx() which are shared by the threads:
+typedef struct {
+	const unsigned char* data;
+	size_t               size;
+	const uint32_t*      records;
+	int                  count;
+	int                  next;      // index of the next file to convert
+	PmxBuffer*           outputs;   // PMX text of each file
+	pthread_mutex_t      mutex;
+} BatchFiles;
+#endif
+
+// State of the conversion of beginConversion() and nextChunk():
+typedef struct {
+	ScoreData     score;
+	ScoreIterator iterator;   // the next item to convert
+	PmxWriter     writer;     // writes into pending
+	PmxBuffer     pending;    // converted text which was not returned yet
+	size_t        position;   // start of the text in pending to return next
+	int           active;     // set until all items have been converted
+} PmxStream;
+
+PmxStream pmx_stream;
 
 // Function declarations:
-void   processMusFile         (const unsigned char* data, size_t length);
-void   appendToPmxOutput      (const char* format, ...);
-void   resetPmxOutput         (void);
-int    printTextItem          (const unsigned char** input, int count);
-void   printNumericItem       (const unsigned char** input, int count);
-int    printItemParameters    (const unsigned char** data, int count);
-int    readLittleShort        (const unsigned char** data);
-int    readLittleInt          (const unsigned char** data);
-double readLittleFloat        (const unsigned char** data);
-double roundFractionDigits    (double number, int digits);
+void       processMusFile         (const unsigned char* data, size_t length);
+void       appendMusConversion    (PmxBuffer* buffer, const unsigned char* data,
+                                   size_t length);
+int        appendToPmxOutput      (void* context, const char* text, size_t size);
+int        reservePmxOutput       (PmxBuffer* buffer, size_t size);
+void       resetPmxOutput         (void);
+#ifdef __EMSCRIPTEN_PTHREADS__
+PmxBuffer* convertFilesInThreads  (const unsigned char* data, size_t size,
+                                   const uint32_t* records, int count);
+void*      convertBatchFiles      (void* arg);
+#endif
+void       convertStreamItems     (PmxStream* stream, size_t size);
+void       appendStreamError      (PmxStream* stream, const char* error);
+size_t     findChunkEnd           (const char* text, size_t maxBytes);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -59,13 +147,18 @@ double roundFractionDigits    (double number, int digits);
 
 EMSCRIPTEN_KEEPALIVE void convertMusToPmx(const unsigned char* data, size_t length);
 EMSCRIPTEN_KEEPALIVE const char* getPmxOutput();
+EMSCRIPTEN_KEEPALIVE size_t getPmxOutputLength();
+EMSCRIPTEN_KEEPALIVE const uint32_t* convertMusFilesToPmx(const unsigned char* data,
+		size_t size, const uint32_t* records, const char* names, int count);
+EMSCRIPTEN_KEEPALIVE void beginConversion(const unsigned char* data, size_t length);
+EMSCRIPTEN_KEEPALIVE const char* nextChunk(size_t maxBytes);
 
 
 //////////////////////////////
 //
 // convertMusToPmx -- Input MUS binary data, and then store the
-//      ASCII output to the pmx_output array, with the size of the
-//      used region of the buffer stored in pmx_index.  This is the
+//      ASCII output to the pmx_output buffer, with the size of the
+//      used region of the buffer stored in pmx_output.length.  This is the
 //      function to call from JavaScript to load the intput MUS
 //      data.
 //
@@ -88,272 +181,269 @@ void convertMusToPmx(const unsigned char* data, size_t length) {
 //
 
 const char* getPmxOutput() {
-	return pmx_output;
+	return pmx_output.text ? pmx_output.text : "";
 }
 
-//
-// WASM-exported functions
-//
-//////////////////////////////
-
 
 //////////////////////////////
 //
-// resetPmxOutput -- Clear the pmx_output buffer of old data.
+// getPmxOutputLength -- Return the number of bytes of the text from
+//     getPmxOutput() (not including the terminating null character).
+//     The buffer may move in memory with each conversion, so call
+//     getPmxOutput() again after each conversion as well.
 //
 
-void resetPmxOutput() {
-	pmx_index = 0;
-	memset(pmx_output, 0, PMX_BUFFER_SIZE);
+size_t getPmxOutputLength() {
+	return pmx_output.length;
 }
 
 
-
 //////////////////////////////
 //
-// appendToPmxOutput -- Add more text to the output buffer.
+// convertMusFilesToPmx -- Convert multiple MUS files in one call.  The
+//      files are stored one after another in data (which has size
+//      bytes), and records contains the offset (from the start of data)
+//      and the length of each file, as pairs of 32-bit integers.  If
+//      names is not NULL, it contains the filename of each file, each
+//      terminated by a null character, for the ##FILE: lines of the
+//      output (otherwise there are no ##FILE: lines).  The pages are
+//      separated by ##PAGEBREAK lines.  The output is the same as for
+//      convertMusToPmx() if there is only one file.  A file with an
+//      error contains the error message as its last line, and the
+//      following files are still converted.
+//
+//      Returns a table of count pairs of 32-bit integers, which are the
+//      offset and length of the PMX text of each file in the buffer from
+//      getPmxOutput() (without the ##FILE: and ##PAGEBREAK lines), or
+//      NULL if out of memory.  The table is valid until the next call.
+//
+//    Javascript summary:
+//          const recordsAt = (totalSize + 3) & ~3;
+//          const ptr = exports.malloc(recordsAt + 8 * count);
+//          ... copy the files to ptr, and the records to ptr + recordsAt ...
+//          const table = exports.convertMusFilesToPmx(ptr, totalSize,
+//                ptr + recordsAt, 0, count);
+//          const records = new Uint32Array(exports.memory.buffer, table, 2 * count);
 //
 
-void appendToPmxOutput(const char* format, ...) {
-	va_list args;
-	va_start(args, format);
-	pmx_index += vsnprintf(pmx_output + pmx_index, PMX_BUFFER_SIZE - pmx_index, format, args);
-	va_end(args);
-}
+const uint32_t* convertMusFilesToPmx(const unsigned char* data, size_t size,
+		const uint32_t* records, const char* names, int count) {
+	resetPmxOutput();
+	if (count < 0) {
+		count = 0;
+	}
+	if (count > pmx_recordCapacity) {
+		uint32_t* larger = (uint32_t*)realloc(pmx_records,
+				2 * count * sizeof(uint32_t));
+		if (larger == NULL) {
+			return NULL;
+		}
+		pmx_records        = larger;
+		pmx_recordCapacity = count;
+	}
+	// The PMX text is usually about twice the size of the binary data.
+	reservePmxOutput(&pmx_output, 2 * size + 64 * count);
+
+	PmxBuffer* converted = NULL;
+#ifdef __EMSCRIPTEN_PTHREADS__
+	converted = convertFilesInThreads(data, size, records, count);
+#endif
+
+	int i;
+	for (i=0; i<count; i++) {
+		if ((count > 1) && (names != NULL)) {
+			appendToPmxOutput(&pmx_output, "##FILE:\t", 8);
+			appendToPmxOutput(&pmx_output, names, strlen(names));
+			appendToPmxOutput(&pmx_output, "\n", 1);
+			names += strlen(names) + 1;
+		}
+		size_t start  = pmx_output.length;
+		size_t offset = records[2 * i];
+		size_t length = records[2 * i + 1];
+		if ((offset > size) || (length > size - offset)) {
+			char error[SCORE_ERROR_SIZE];
+			snprintf(error, sizeof(error),
+					"Error: file %d is outside of the input data.\n", i + 1);
+			appendToPmxOutput(&pmx_output, error, strlen(error));
+		} else if (converted != NULL) {
+			appendToPmxOutput(&pmx_output, converted[i].text, converted[i].length);
+		} else {
+			appendMusConversion(&pmx_output, data + offset, length);
+		}
+		pmx_records[2 * i]     = (uint32_t)start;
+		pmx_records[2 * i + 1] = (uint32_t)(pmx_output.length - start);
+		if (i < count - 1) {
+			appendToPmxOutput(&pmx_output, "##PAGEBREAK\n", 12);
+		}
+	}
 
+	if (converted != NULL) {
+		for (i=0; i<count; i++) {
+			free(converted[i].text);
+		}
+		free(converted);
+	}
+	return pmx_records;
+}
 
 
 //////////////////////////////
 //
-// processMusFile -- Do the conversion from MUS to PMX.
-//    Binary SCORE files can be read into the SCORE editor with the command
-//    "G file[.mus]", ASCII Parameter MatriX files can be read into SCORE
-//    with the command "RE file.pmx".  The default file extension for
-//    binary files is ".mus", but also ".pag" is common when the MUS file
-//    contains a complete page (but this is optional).
+// beginConversion -- Start the conversion of MUS binary data in chunks,
+//      which are returned by nextChunk().  The data must not be changed
+//      or freed until nextChunk() returns NULL (or until the next call of
+//      beginConversion()).  If the data is invalid, the only chunk is the
+//      error message.
 //
 //   Input parameters:
 //      const unsigned char* data: bytes from the input mus file.
 //      size_t length: length of the data array in bytes.
 //
-//    Javascript summary:
-//          const reader = new FileReader();
-//          const uint8Array = new Uint8Array(reader.result);
-//          const ptr = wasmModule.malloc(uint8Array.length);
-//          wasmModule.convertMusToPmx(ptr, uint8Array.length);
-//
 
-void processMusFile(const unsigned char* data, size_t length) {
-	resetPmxOutput();
-
-	if (length < 4) {
-		appendToPmxOutput("Error: File too small\n");
+void beginConversion(const unsigned char* data, size_t length) {
+	PmxStream* stream = &pmx_stream;
+	stream->pending.length  = 0;
+	stream->position        = 0;
+	stream->active          = 1;
+	stream->writer.write    = appendToPmxOutput;
+	stream->writer.context  = &stream->pending;
+	stream->writer.flags    = SCORE_PMX_HEADER;
+	stream->writer.error[0] = '\0';
+	if (openScoreData(&stream->score, data, length) != 0) {
+		appendStreamError(stream, stream->score.error);
 		return;
 	}
+	beginScoreItems(&stream->iterator, &stream->score);
+	if (writePmxHeader(&stream->writer, &stream->score) != 0) {
+		appendStreamError(stream, stream->writer.error);
+	}
+}
 
-	const unsigned char* ptr = data;
-
-	// If the file size mod 4 has a remainder of 0, then the item
-	// count field at the start of the file is four bytes (a big MUS
-	// file created by later versions of SCORE when there are more than
-	// 2^16-1 numbers or four-byte chuncks of text.  If the remainder
-	// is 2 instead of 0, then it is a small MUS file with less data.
-	int countFieldByteSize = (length % 4 == 0) ? 4 : 2;
-
-	int numberCount = (countFieldByteSize == 2) ? readLittleShort(&ptr) : readLittleInt(&ptr);
 
-	// Verify that the length of the data matches the length of the input data:
-	if (length < (size_t)(4 * numberCount)) {
-		appendToPmxOutput("Error: Invalid file length\n");
-		return;
+//////////////////////////////
+//
+// nextChunk -- Return the next chunk of the PMX text of the conversion
+//      started by beginConversion(), or NULL after the last chunk.  The
+//      chunk contains complete lines, and is at most maxBytes long unless
+//      a single line is longer (which is then returned by itself).
+//      getPmxOutputLength() returns the length of the chunk, which is
+//      stored in the same buffer as the output of convertMusToPmx(), and
+//      is valid until the next call.  The chunks together are the same
+//      text as the output of convertMusToPmx().
+//
+//    Javascript summary:
+//          exports.beginConversion(ptr, bytes.length);
+//          let chunk;
+//          while ((chunk = exports.nextChunk(65536)) !== 0) {
+//             const text = new Uint8Array(exports.memory.buffer, chunk,
+//                   exports.getPmxOutputLength());
+//             ... decode and use the lines of the text ...
+//          }
+//          exports.free(ptr);
+//
+
+const char* nextChunk(size_t maxBytes) {
+	PmxStream* stream = &pmx_stream;
+	resetPmxOutput();
+	while (1) {
+		const char* text = stream->pending.text + stream->position;
+		size_t available = stream->pending.length - stream->position;
+		if (available == 0) {
+			if (!stream->active) {
+				break;
+			}
+			// The PMX text is usually two to four times the size of the
+			// binary data.
+			convertStreamItems(stream, maxBytes / 4 + 1);
+			continue;
+		}
+		size_t room = pmx_output.length < maxBytes ?
+				maxBytes - pmx_output.length : 0;
+		size_t size = available;
+		if (size > room) {
+			size = findChunkEnd(text, room);
+			if ((size == 0) && (pmx_output.length == 0)) {
+				// A line which is longer than maxBytes is returned by itself:
+				const char* newline = (const char*)memchr(text, '\n', available);
+				size = newline ? (size_t)(newline - text) + 1 : available;
+			}
+		}
+		if ((size > 0) && (appendToPmxOutput(&pmx_output, text, size) != 0)) {
+			break;
+		}
+		stream->position += size;
+		if (size < available) {
+			break;
+		}
 	}
+	return pmx_output.length ? pmx_output.text : NULL;
+}
 
-	// Verify that the last four bytes in the file represent the
-	// floating-point number -9999.0:
-	ptr = data + length - 4;
-	double lastNumber = readLittleFloat(&ptr);
-	if (lastNumber != -9999.0) {
-		appendToPmxOutput("Error: last number is not -9999.0 but instead is %.1lf\n", lastNumber);
-		return;
-	}
+//
+// WASM-exported functions
+//
+//////////////////////////////
 
-	// Now read the trailer of the file.  First go to 8 bytes before the
-	// end of the file and read how many bytes are in the trailer
-	// There should be at least 5 numbers (or maybe 4). In reverse order
-	// from the end of the file, these are:
-	//    number 1: The number of floats in the trailer (including
-	//              this value.  Standard value is "5.0"  For future
-	//              versions of SCORE, this value might be larger, but
-	//              it will never be smaller.  Numbers 2, 3, and 4 will
-	//              always have a fixed meaning in any future versions
-	//              of SCORE, and extra parameters will be added before
-	//              them in the file if this value is larger than 5.0.
-	//    number 2: The measurement code: 0.0 = inches, 1.0 = centimeters.
-	//              This is needed for certain length measurements for
-	//              certain items (not often used).
-	//    number 3: Program version number which created the file.
-	//    number 4: Program serial number which created the file.
-	//    number 5: The last number in the trailer (i.e., the first
-	//              trailer byte within the file) must be set to 0.0;
-	//              This is an alternate way of identifying the trailer
-	//              after a list of items.  No item should have a
-	//              parameter size of 0.0, so a parameter size of 0.0
-	//              would indicate the end of the data and the start
-	//              of the trailer.
-
-	// (1) The number of parameters in the trailer (including this number):
-	ptr = data + length - 8;
-	double trailerSize = readLittleFloat(&ptr);
-
-	if (trailerSize < 4.0) {
-		appendToPmxOutput("Error: trailer size is less than 3 values: %d\n", trailerSize);
-		return;
-	}
 
-	// (2) The unit type (inches or centimeters):
-	// Possible values:
-	//    0.0 = inches
-	//    1.0 = centimeters
-	ptr = data + length - 12;
-	double unitType = readLittleFloat(&ptr);
-
-	// (3) The SCORE version number which created the data
-	// (or the target SCORE version for the data).
-	ptr = data + length - 16;
-	double versionNumber = readLittleFloat(&ptr);
-
-	// (4) The serial number of the SCORE program which created
-	// the data file (or zero otherwise).  SCORE version 4 (and higher)
-	// contains a serial number of the program used to create the
-	// data file.
-	double serialNumber = 0.0;
-	if (trailerSize > 4.0) {
-		ptr = data + length - 20;
-		serialNumber = readLittleFloat(&ptr);
-	}
+//////////////////////////////
+//
+// resetPmxOutput -- Start a new output text.  The old text is not
+//     cleared, since only the first pmx_output.length bytes are used.
+//
 
-	// (5) The last parameter in the trailer should be 0.0,
-	// so this would be good to check in case the trailer is
-	// corrupted.  Ignoring for now (and its position could be
-	// later if the trailer parameter count is larger than 5.
-
-	// Print the PMX header extracted from the MUS trailer:
-	if (unitType == 0.0) {
-		appendToPmxOutput("##UNITS:\tinches\n");
-	} else if (unitType == 1.0) {
-		appendToPmxOutput("##UNITS:\tcentimeters\n");
-	} else {
-		// appendToPmxOutput("##UNITS:\tunknown\n");
-	}
-	appendToPmxOutput("##VERSION:\t%.2lf\n", versionNumber);
-	if ((trailerSize > 4.0) && (serialNumber > 0)) {
-		appendToPmxOutput("##SERIAL:\t%lf\n", serialNumber);
+void resetPmxOutput() {
+	pmx_output.length = 0;
+	if (reservePmxOutput(&pmx_output, 0) == 0) {
+		pmx_output.text[0] = '\0';
 	}
+}
 
-	// Go back to the start of the list of parameters after the
-	// initial 2- or 4-byte count of floats until the trailer.
-	ptr = data + countFieldByteSize;
 
-	int trailerBytes = 4 * ((int)trailerSize + 1);
-	while (ptr < data + length - trailerBytes) {
-		// Number of numbers (4-byte chunks of data) to follow this number:
-		double parameterCount = readLittleFloat(&ptr);
-		parameterCount = roundFractionDigits(parameterCount, 3);
 
-		if (parameterCount <= 0.0) {
-			appendToPmxOutput("Error: parameter size item is zero.\n");
-			return;
-		}
+//////////////////////////////
+//
+// appendToPmxOutput -- Add more text to an output buffer (the write
+//     function for convertScoreToPmx(), with the buffer as the context),
+//     followed by a null character.  Returns -1 if the buffer cannot grow
+//     large enough for the text.
+//
 
-		int status = printItemParameters(&ptr, parameterCount);
-		if (status != 0) {
-			break;
-		}
+int appendToPmxOutput(void* context, const char* text, size_t size) {
+	PmxBuffer* buffer = (PmxBuffer*)context;
+	if (reservePmxOutput(buffer, size) != 0) {
+		return -1;
 	}
+	memcpy(buffer->text + buffer->length, text, size);
+	buffer->length += size;
+	buffer->text[buffer->length] = '\0';
+	return 0;
 }
 
 
 
 //////////////////////////////
 //
-// printItemParameters -- print the given number of parameters
-//    in the musical item at the current point in the file.
-//    Paramters with some non-numeric data are:
-//      P1 = 16: text
-//      P1 = 15: EPS graphic item
-//      P1 = 13: Not used
-//      P1 = 100+: (or 99+) not possible to use.
-//
-
-int printItemParameters(const unsigned char** input, int count) {
-	// P1 == parameter 1, which is the item type
-	double P1           = readLittleFloat(input);
-	char   buffer[1024] = {0};
-	int    i;
-	if (P1 <= 0.0) {
-		appendToPmxOutput("Strange error: P1 is non-positive: %lf\n", P1);
-		return -1;
+// reservePmxOutput -- Make sure that an output buffer has space for
+//     size more bytes and a null character.  The buffer size is doubled
+//     when it needs to grow.  Returns -1 if out of memory (the buffer is
+//     then unchanged).
+//
+
+int reservePmxOutput(PmxBuffer* buffer, size_t size) {
+	size_t needed = buffer->length + size + 1;
+	if (needed <= buffer->capacity) {
+		return 0;
 	}
-	if (P1 >= 99.0) {
-		appendToPmxOutput("Strange error: P1 is way too large: %lf\n", P1);
-		return -1;
+	size_t capacity = buffer->capacity ? 2 * buffer->capacity : PMX_BUFFER_SIZE;
+	if (capacity < needed) {
+		capacity = needed;
 	}
-	if (P1 == 16.0) {
-		// text items use "t" instead of "16.0" for the first parameter
-		// in the item when displaying as ASCII PMX data.
-		appendToPmxOutput("t     ");
-		printTextItem(input, count-1);
-	} else if (P1 == 15.0) {
-		// print EPS graphic item
-		// The first 13 4-byte words are numeric parameters
-		// Parameter 13 should probably not be printed in the PMX data
-		// since it is only used to edit the filename in the SCORE editor.
-		if (count < 13) {
-			appendToPmxOutput("Error: EPS graphic item has too few parameters\n");
-			return -1;
-		}
-		appendToPmxOutput("%2.3lf", P1);
-		printNumericItem(input, 12);
-		// Read the remaining bytes into a string to print as the EPS filename.
-		count = count - 13;
-		if (count <= 0) {
-			appendToPmxOutput("Error: expecting non-zero count for P1=15 filename\n");
-			return -1;
-		}
-		if (count > 200) {
-			appendToPmxOutput("Error: P1=15 filename too long.\n");
-			return -1;
-		}
-
-		// Copy the data from the buffer
-		memcpy(buffer, *input, count * 4);
-		buffer[count * 4] = '\0';  // Ensure null termination
-		*input += count * 4; // Advance the input pointer
-
-		// remove any trailing spaces in filename
-		for (i=count*4-1; i>=0; i--) {
-			if (buffer[i] == 0x20) {
-				buffer[i] = '\0';
-			} else {
-				break;
-			}
-		}
-		appendToPmxOutput("%s\n", buffer);
-	} else {
-		// Print non-text items.
-		if (P1 < 10) {
-			// The first character on the line for a PMX should not be a space.
-			// The fractional value is usually not used (always .0000).  But
-			// Walter's data and the newest Windows SCORE files may contain
-			// non-zero fraction digits which describe the layer number of
-			// the items on the staff.
-			appendToPmxOutput("%1.4lf", P1);
-		} else {
-			appendToPmxOutput("%2.3lf", P1);
-		}
-		printNumericItem(input, count-1);
+	char* larger = (char*)realloc(buffer->text, capacity);
+	if (larger == NULL) {
+		return -1;
 	}
-
+	buffer->text     = larger;
+	buffer->capacity = capacity;
 	return 0;
 }
 
@@ -361,136 +451,208 @@ int printItemParameters(const unsigned char** input, int count) {
 
 //////////////////////////////
 //
-// printTextItem -- print a P1=16 item, starting with P2 value.
-//
-
-int printTextItem(const unsigned char** input, int count) {
-   if (count < 12) {
-      appendToPmxOutput("# Error reading binary text item: there must be 13 fixed ");
-      appendToPmxOutput("parameters, but there are instead %d.\n", count);
-      return -1;
-   }
-
-   // First print the fixed parameters for the text item:
-   int characterCount = -1;
-   for (int i=0; i<12; i++) {
-      double number = readLittleFloat(input);
-      number = roundFractionDigits(number, 3);
-      appendToPmxOutput(" %8.3lf", number);
-      if (i == 10) {
-         // P12 is the number of characters in the string which follows.
-         characterCount = (int)number;
-      }
-   }
-   appendToPmxOutput("\n");
-
-   if (debugQ) {
-      appendToPmxOutput("# String length is %d\n", characterCount);
-   }
-
-   // Read text string:
-   char buffer[1024] = {0};
-	if (characterCount < 1024) {
-   	memcpy(buffer, *input, characterCount);
-	}
-   buffer[characterCount] = '\0';
-   *input += characterCount; // Advance pointer
-
-   appendToPmxOutput("%s\n", buffer);
-
-   // Next, read extra padding bytes (ensuring string field is a multiple of 4 bytes)
-   int extraBytes = characterCount % 4;
-   if (debugQ) {
-      appendToPmxOutput("# Extra padding bytes after string is %d\n", 4 - extraBytes);
-   }
-   if (extraBytes > 0 && extraBytes < 4) {
-      *input += (4 - extraBytes); // Skip padding
-   }
+// processMusFile -- Do the conversion from MUS to PMX.
+//    Binary SCORE files can be read into the SCORE editor with the command
+//    "G file[.mus]", ASCII Parameter MatriX files can be read into SCORE
+//    with the command "RE file.pmx".  The default file extension for
+//    binary files is ".mus", but also ".pag" is common when the MUS file
+//    contains a complete page (but this is optional).
+//
+//   Input parameters:
+//      const unsigned char* data: bytes from the input mus file.
+//      size_t length: length of the data array in bytes.
+//
+//    Javascript summary:
+//          const reader = new FileReader();
+//          const uint8Array = new Uint8Array(reader.result);
+//          const ptr = wasmModule.malloc(uint8Array.length);
+//          wasmModule.convertMusToPmx(ptr, uint8Array.length);
+//
 
-	return 0;
+void processMusFile(const unsigned char* data, size_t length) {
+	resetPmxOutput();
+	// The PMX text is usually about twice the size of the binary data
+	// (the buffer grows if it is larger).
+	reservePmxOutput(&pmx_output, 2 * length);
+	appendMusConversion(&pmx_output, data, length);
 }
 
 
 
 //////////////////////////////
 //
-// printNumericItem -- print a P1!=16 item, starting with P2 value.
-//    Also, PostScript items (P1==15) should probably not be printed
-//    with this function (but currently are).
+// appendMusConversion -- Add the PMX text of a MUS file to an output
+//    buffer, followed by the error message if there is an error.
 //
 
-void printNumericItem(const unsigned char** input, int count) {
-   for (int i=0; i<count; i++) {
-      double number = readLittleFloat(input);
-      number = roundFractionDigits(number, 3);
-      appendToPmxOutput(" %8.3lf", number);
-   }
-   appendToPmxOutput("\n");
+void appendMusConversion(PmxBuffer* buffer, const unsigned char* data,
+		size_t length) {
+	PmxWriter writer;
+	writer.write   = appendToPmxOutput;
+	writer.context = buffer;
+	writer.flags   = SCORE_PMX_HEADER;
+	if (convertScoreToPmx(&writer, data, length) != 0) {
+		appendToPmxOutput(buffer, writer.error, strlen(writer.error));
+		appendToPmxOutput(buffer, "\n", 1);
+	}
 }
 
 
 
+#ifdef __EMSCRIPTEN_PTHREADS__
+
 //////////////////////////////
 //
-// readLittleShort -- Read a (two-byte) unsigned short at the current
-//   read position in a file that is stored in the file in little-endian
-//   ordering.
+// convertFilesInThreads -- Convert the files of convertMusFilesToPmx()
+//    into a separate buffer for each file, using as many threads as
+//    there are processors (up to WASM_THREADS).  The calling thread
+//    converts files as well.  Files outside of the input data are left
+//    empty (the caller adds the error message).  Returns the buffers,
+//    or NULL if the files should be converted by the caller instead
+//    (for a single file or processor, or if out of memory).
 //
 
-int readLittleShort(const unsigned char** data) {
-	int value = (*data)[1] << 8 | (*data)[0];
-	*data += 2;
-	return value;
+PmxBuffer* convertFilesInThreads(const unsigned char* data, size_t size,
+		const uint32_t* records, int count) {
+	int threads = emscripten_num_logical_cores();
+	if (threads > WASM_THREADS) {
+		threads = WASM_THREADS;
+	}
+	if (threads > count) {
+		threads = count;
+	}
+	if (threads < 2) {
+		return NULL;
+	}
+	BatchFiles batch;
+	batch.data    = data;
+	batch.size    = size;
+	batch.records = records;
+	batch.count   = count;
+	batch.next    = 0;
+	batch.outputs = (PmxBuffer*)calloc(count, sizeof(PmxBuffer));
+	if (batch.outputs == NULL) {
+		return NULL;
+	}
+	pthread_mutex_init(&batch.mutex, NULL);
+
+	// The threads come from the pool which is created when the module is
+	// loaded (PTHREAD_POOL_SIZE), so they start without waiting for the
+	// browser to create a worker.
+	pthread_t workers[WASM_THREADS];
+	int started;
+	for (started=0; started<threads-1; started++) {
+		if (pthread_create(&workers[started], NULL, convertBatchFiles,
+				&batch) != 0) {
+			break;
+		}
+	}
+	convertBatchFiles(&batch);
+	int i;
+	for (i=0; i<started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	pthread_mutex_destroy(&batch.mutex);
+	return batch.outputs;
 }
 
 
 
 //////////////////////////////
 //
-// readLittleInt -- Read a (four-byte) unsigned int at the current
-//   read position in a file that is stored in the file in little-endian
-//   ordering.
+// convertBatchFiles -- Thread function which converts the next file of
+//    the batch until all files have been converted.
 //
 
-int readLittleInt(const unsigned char** data) {
-	int value = (*data)[3] << 24 | (*data)[2] << 16 | (*data)[1] << 8 | (*data)[0];
-	*data += 4;
-	return value;
+void* convertBatchFiles(void* arg) {
+	BatchFiles* batch = (BatchFiles*)arg;
+	while (1) {
+		pthread_mutex_lock(&batch->mutex);
+		int i = batch->next++;
+		pthread_mutex_unlock(&batch->mutex);
+		if (i >= batch->count) {
+			break;
+		}
+		size_t offset = batch->records[2 * i];
+		size_t length = batch->records[2 * i + 1];
+		if ((offset > batch->size) || (length > batch->size - offset)) {
+			continue;
+		}
+		reservePmxOutput(&batch->outputs[i], 2 * length);
+		appendMusConversion(&batch->outputs[i], batch->data + offset, length);
+	}
+	return NULL;
 }
 
+#endif  /* __EMSCRIPTEN_PTHREADS__ */
+
 
 
 //////////////////////////////
 //
-// readLittleFloat -- Read a (four-byte) signed float at the
-//     current position in a file, and which is stored in the file
-//     in little-endian ordering.
+// convertStreamItems -- Replace the pending text of a stream with the
+//    PMX text of the next items, which have about size bytes of binary
+//    data (at least one item).  If an item is invalid, the rest of the
+//    items are converted, so that the error message is added after the
+//    text of the items before it (the same as for convertMusToPmx()).
+//
+
+void convertStreamItems(PmxStream* stream, size_t size) {
+	stream->pending.length = 0;
+	stream->position       = 0;
+	const unsigned char* start = stream->iterator.ptr;
+	const unsigned char* end   = start;
+	ScoreItem item;
+	int status;
+	while ((status = nextScoreItem(&stream->iterator, &item)) > 0) {
+		end = stream->iterator.ptr;
+		if ((size_t)(end - start) >= size) {
+			break;
+		}
+	}
+	if (status < 0) {
+		end = stream->score.itemsEnd;
+	}
+	if (end >= stream->score.itemsEnd) {
+		stream->active = 0;
+	}
+	if ((end > start) && (convertScoreItemsToPmx(&stream->writer,
+			&stream->score, start, end) != 0)) {
+		appendStreamError(stream, stream->writer.error);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// appendStreamError -- Add an error message as the last line of the
+//    text of a stream.
 //
 
-double readLittleFloat(const unsigned char** data) {
-	union { float f; unsigned int i; } num;
-	num.i = (*data)[3] << 24 | (*data)[2] << 16 | (*data)[1] << 8 | (*data)[0];
-	*data += 4;
-	return num.f;
+void appendStreamError(PmxStream* stream, const char* error) {
+	appendToPmxOutput(&stream->pending, error, strlen(error));
+	appendToPmxOutput(&stream->pending, "\n", 1);
+	stream->active = 0;
 }
 
 
 
 //////////////////////////////
 //
-// roundFractionDigits -- Round a floating-point number to the speicified
-//    number of siginificant digits after the decimal point.  SCORE binary
-//    values are floats, and they usually contain (roundoff?) junk after
-//    the third digit after the decimal point.
+// findChunkEnd -- Return the length of the complete lines at the start
+//    of text which fit into maxBytes (0 if the first line does not fit).
+//    The text must be longer than maxBytes.
 //
 
-double roundFractionDigits(double number, int digits) {
-	double dshift = pow(10.0, digits);
-	if (number < 0.0) {
-		return ((int)(number * dshift - 0.5))/dshift;
-	} else {
-		return ((int)(number * dshift + 0.5))/dshift;
+size_t findChunkEnd(const char* text, size_t maxBytes) {
+	size_t i;
+	for (i=maxBytes; i>0; i--) {
+		if (text[i - 1] == '\n') {
+			return i;
+		}
 	}
+	return 0;
 }
 
 
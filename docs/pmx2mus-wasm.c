@@ -0,0 +1,106 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:42:14 PDT 2026
+// Last Modified: Thu Oct 15 20:42:14 PDT 2026
+// Filename:      pmx2mus-wasm.c
+// Syntax:        C; Emscripten
+// vim:           ts=3:nowrap
+//
+// Description:   Emscripten version of the pmx2mus program for JavaScript that converts
+//                ASCII (PMX) data into a binary SCORE file.  The
+//                conversion is done by libscore (../libscore.h), the same
+//                as in the command-line version of pmx2mus, but the input
+//                and the output are buffers in the wasm memory instead of
+//                files.  The output buffer is kept until the next
+//                conversion.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <emscripten.h>
+
+#include "../libscore.h"
+
+// Builder for the binary SCORE output data:
+ScoreBuilder         mus_builder;
+const unsigned char* mus_output = NULL;
+size_t               mus_length = 0;
+
+// Function declarations:
+void   resetMusOutput         (void);
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// WASM-exported functions (see mus2pmx-wasm.c for EMSCRIPTEN_KEEPALIVE)
+//
+
+EMSCRIPTEN_KEEPALIVE const unsigned char* convertPmxToMus(const char* text, size_t length);
+EMSCRIPTEN_KEEPALIVE size_t getMusOutputLength();
+
+
+//////////////////////////////
+//
+// convertPmxToMus -- Input PMX text, and return the address of the
+//      binary SCORE data which it is converted into.  getMusOutputLength()
+//      returns the size of the data.  Returns NULL (with a length of 0)
+//      if there is not enough memory for the data.  The data stays valid
+//      until the next call.
+//
+//   Input parameters:
+//      const char* text: the PMX text (which does not need to be
+//            terminated by a null character).
+//      size_t length: length of the text in bytes.
+//
+//    Javascript summary:
+//          const bytes = new TextEncoder().encode(pmx);
+//          const ptr = exports.malloc(bytes.length);
+//          new Uint8Array(exports.memory.buffer).set(bytes, ptr);
+//          const mus = exports.convertPmxToMus(ptr, bytes.length);
+//          const data = new Uint8Array(exports.memory.buffer, mus,
+//                exports.getMusOutputLength()).slice();
+//          exports.free(ptr);
+//
+
+const unsigned char* convertPmxToMus(const char* text, size_t length) {
+	resetMusOutput();
+	// The binary data is usually about half of the size of the PMX text.
+	initScoreBuilder(&mus_builder, length / 2 + 1024);
+	if ((convertPmxToScore(text, length, &mus_builder) != 0) ||
+			(finishScoreData(&mus_builder, &mus_output, &mus_length) != 0)) {
+		resetMusOutput();
+	}
+	return mus_output;
+}
+
+
+//////////////////////////////
+//
+// getMusOutputLength -- Return the number of bytes of the binary SCORE
+//     data from the last call to convertPmxToMus().
+//
+
+size_t getMusOutputLength() {
+	return mus_length;
+}
+
+//
+// WASM-exported functions
+//
+//////////////////////////////
+
+
+
+//////////////////////////////
+//
+// resetMusOutput -- Free the output data of the previous conversion.
+//
+
+void resetMusOutput() {
+	freeScoreBuilder(&mus_builder);
+	mus_output = NULL;
+	mus_length = 0;
+}
+
+
+
@@ -2,15 +2,21 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Jun 10 17:10:59 PDT 2015
 // Last Modified: Wed Jun 10 19:33:49 PDT 2015
+// Last Modified: Thu Oct 15 20:29:08 PDT 2026 added --trace timeline
 // Filename:      drw2aton.c
 // Syntax:        C
 //
 // Description:   Convert binary SCORE DRAW files (typically ending in the
 //                extension .drw) into an ASCII format (ATON structure).
 //
-// Usage:         drw2aton file.drw [file2.drw] > file.aton
+//                The --trace option writes a timeline of the conversion
+//                in the Trace Event JSON format (see trace.h), with a span
+//                for each file containing spans for reading the file,
+//                printing the symbols and flushing the output.
 //
-// $Smake:        gcc -O3 -o drw2aton -lm drw2aton.c
+// Usage:         drw2aton [--trace trace.json] file.drw [file2.drw] > file.aton
+//
+// $Smake:        gcc -O3 -o drw2aton drw2aton.c trace.c -lm -lpthread
 //
 
 #include <stdio.h>
@@ -19,6 +25,8 @@
 #include <math.h>
 #include <ctype.h>
 
+#include "trace.h"
+
 // function declarations:
 void     printBinaryDrawFileAsAscii  (const char* filename);
 int      readChar                    (FILE* input);
@@ -36,12 +44,32 @@ int debugQ   = 0;  // turn on for debugging display
 ///////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
+   const char* traceFile = NULL;
+   int first = 1;
+   if ((argc > 2) && (strcmp(argv[1], "--trace") == 0)) {
+      traceFile = argv[2];
+      first = 3;
+      startTrace("drw2aton");
+   }
+
    int i;
    printf("@@BEGIN: FONT_LIBRARY\n");
-   for (i=1; i<argc; i++) {
+   for (i=first; i<argc; i++) {
+      double start = isTracing() ? getTraceTime() : 0.0;
       printBinaryDrawFileAsAscii(argv[i]);
+      if (isTracing()) {
+         double flush = getTraceTime();
+         fflush(stdout);
+         double end = getTraceTime();
+         addTraceSpan("flush", NULL, flush, end);
+         addTraceSpan("file", argv[i], start, end);
+      }
    }
    printf("@@END: FONT_LIBRARY\n");
+
+   if ((traceFile != NULL) && (writeTrace(traceFile) != 0)) {
+      return 1;
+   }
    return 0;
 }
 
@@ -56,6 +84,7 @@ int main(int argc, char** argv) {
 //
 
 void printBinaryDrawFileAsAscii(const char* filename) {
+   double start = isTracing() ? getTraceTime() : 0.0;
    FILE *input = fopen(filename, "r");
    if (debugQ) {
       printf("@ FILENAME:\t%s\n", filename);
@@ -104,7 +133,14 @@ void printBinaryDrawFileAsAscii(const char* filename) {
       // do nothing;
    }
 
-   printDrawData(filename, fontNames, vectorOffsets, vectors);
+   if (isTracing()) {
+      double time = getTraceTime();
+      addTraceSpan("read", NULL, start, time);
+      printDrawData(filename, fontNames, vectorOffsets, vectors);
+      addTraceSpan("symbols", NULL, time, getTraceTime());
+   } else {
+      printDrawData(filename, fontNames, vectorOffsets, vectors);
+   }
 }
 
 
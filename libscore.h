@@ -0,0 +1,177 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:18:57 PDT 2026
+// Last Modified: Thu Oct 15 20:20:29 PDT 2026 added trailer probe
+// Last Modified: Thu Oct 15 20:33:08 PDT 2026 convert ranges of items
+// Last Modified: Thu Oct 15 20:35:21 PDT 2026 added appendScoreItems()
+// Last Modified: Thu Oct 15 20:38:08 PDT 2026 added SCORE_LIBRARY_VERSION
+// Filename:      libscore.h
+// Syntax:        C
+//
+// Description:   Library for reading and writing binary SCORE data
+//                (.mus/.pag files) and converting between binary SCORE
+//                data and PMX text.  The mus2pmx and pmx2mus programs and
+//                the WebAssembly version of mus2pmx use this library.
+//
+//                Reading:  openScoreData() checks the count field and the
+//                   trailer of binary SCORE data in memory, and then
+//                   nextScoreItem() steps through the items.  The items
+//                   point into the original data, so nothing is copied.
+//                   probeScoreFile() reads only the count field and the
+//                   trailer of a file.
+//                Writing:  A ScoreBuilder collects items with
+//                   addScoreItem(), and finishScoreData() adds the count
+//                   field and the trailer.  appendScoreItems() adds the
+//                   items of another builder, for building the data in
+//                   parts.
+//                PMX:      convertScoreToPmx() writes PMX text for binary
+//                   data through a callback, and convertPmxToScore()
+//                   converts PMX text into binary data with a builder.
+//                   writePmxHeader() and convertScoreItemsToPmx() do the
+//                   same conversion in parts, for a range of the items.
+//                   countScoreItemsToPmx() also counts the items by type.
+//
+//                Build with "make libscore" to create libscore.a and
+//                libscore.so.
+//
+
+#ifndef _LIBSCORE_H_INCLUDED
+#define _LIBSCORE_H_INCLUDED
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCORE_ERROR_SIZE 256
+
+// Version of the conversions, which should be changed whenever the
+// output of a conversion changes (the --cache option of mus2pmx and
+// pmx2mus converts the files again for a new version):
+#define SCORE_LIBRARY_VERSION "2026.10.24"
+
+// Bytes at the start and end of a file which contain the count field
+// and the trailer (for probeScoreData()):
+#define SCORE_PROBE_HEAD 4
+#define SCORE_PROBE_TAIL 20
+
+// P1 values of items which contain text after their numeric parameters:
+#define SCORE_EPS_ITEM   15
+#define SCORE_TEXT_ITEM  16
+
+// Binary SCORE data in memory:
+typedef struct {
+	const unsigned char* data;         // the complete file
+	size_t               size;         // size of the file in bytes
+	int                  countSize;    // 2, or 4 for large WinSCORE files
+	int                  numberCount;  // words after the count field
+	double               trailerSize;  // numbers in the trailer (4 or 5)
+	double               units;        // 0.0 = inches, 1.0 = centimeters
+	double               version;      // SCORE version
+	double               serial;       // serial number (0.0 if none)
+	const unsigned char* items;        // the first item (NULL if probed)
+	const unsigned char* itemsEnd;     // the start of the trailer
+	char                 error[SCORE_ERROR_SIZE];
+} ScoreData;
+
+// One item of the data.  The parameters are the 4-byte little-endian
+// floats of the item, starting with P1.  For text items (P1=16) there
+// are 13 numeric parameters followed by the text, and for EPS graphic
+// items (P1=15) there are 13 numeric parameters followed by the
+// filename (without trailing spaces).
+typedef struct {
+	const unsigned char* start;           // the count word of the item
+	int                  count;           // number of words after start
+	double               P1;              // item type
+	const unsigned char* parameters;      // P1, P2, ...
+	int                  parameterCount;  // number of numeric parameters
+	const char*          text;            // text or filename, or NULL
+	int                  textLength;      // number of characters of text
+} ScoreItem;
+
+typedef struct {
+	const ScoreData*     score;
+	const unsigned char* ptr;
+	char                 error[SCORE_ERROR_SIZE];
+} ScoreIterator;
+
+// Binary SCORE data being created.  The data is stored in memory which
+// grows as needed.  Initialize with initScoreBuilder().
+typedef struct {
+	unsigned char* data;
+	size_t         size;
+	size_t         capacity;
+	size_t         start;     // start of the file in data
+	int            count;     // words stored after the count field
+	int            error;     // set if out of memory
+} ScoreBuilder;
+
+// Receives the PMX text written by convertScoreToPmx().  Returns 0 if
+// successful.
+typedef int (*ScoreWriteFunction)(void* context, const char* text,
+		size_t size);
+
+// Options for convertScoreToPmx():
+#define SCORE_PMX_HEADER 1   // ##UNITS, ##VERSION, ##SERIAL from the trailer
+#define SCORE_PMX_DEBUG  2   // comments describing the file structure
+
+typedef struct {
+	ScoreWriteFunction write;
+	void*              context;
+	int                flags;
+	char               error[SCORE_ERROR_SIZE];
+} PmxWriter;
+
+// Reading binary SCORE data:
+int      openScoreData        (ScoreData* score, const unsigned char* data,
+                               size_t size);
+int      probeScoreData       (ScoreData* score, const unsigned char* head,
+                               const unsigned char* tail, size_t size);
+int      probeScoreFile       (ScoreData* score, const char* filename);
+void     beginScoreItems      (ScoreIterator* iterator,
+                               const ScoreData* score);
+int      nextScoreItem        (ScoreIterator* iterator, ScoreItem* item);
+float    getScoreParameter    (const ScoreItem* item, int number);
+void     getScoreParameters   (const ScoreItem* item, float* output);
+
+// Writing binary SCORE data:
+void     initScoreBuilder     (ScoreBuilder* builder, size_t size);
+int      addScoreItem         (ScoreBuilder* builder, const float* parameters,
+                               int count, const char* text,
+                               size_t textLength);
+int      appendScoreItems     (ScoreBuilder* builder,
+                               const ScoreBuilder* items);
+int      finishScoreData      (ScoreBuilder* builder,
+                               const unsigned char** data, size_t* size);
+void     freeScoreBuilder     (ScoreBuilder* builder);
+
+// Conversion to and from PMX text:
+int      convertScoreToPmx    (PmxWriter* writer, const unsigned char* data,
+                               size_t size);
+int      writePmxHeader       (PmxWriter* writer, const ScoreData* score);
+int      convertScoreItemsToPmx (PmxWriter* writer, const ScoreData* score,
+                               const unsigned char* start,
+                               const unsigned char* end);
+int      countScoreItemsToPmx (PmxWriter* writer, const ScoreData* score,
+                               const unsigned char* start,
+                               const unsigned char* end, long* counts,
+                               int types);
+int      writePmxToFile       (void* file, const char* text, size_t size);
+int      convertPmxToScore    (const char* text, size_t size,
+                               ScoreBuilder* builder);
+
+// Files:
+const unsigned char* mapInputFile    (const char* filename, size_t* length);
+void                 unmapInputFile  (const unsigned char* data,
+                                      size_t length);
+int                  readFileEnds    (const char* filename,
+                                      unsigned char* head, size_t headSize,
+                                      unsigned char* tail, size_t tailSize,
+                                      size_t* length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _LIBSCORE_H_INCLUDED */
@@ -0,0 +1,174 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:04:30 PDT 2026
+// Last Modified: Thu Oct 15 20:04:30 PDT 2026 moved from mus2pmx.c
+// Last Modified: Thu Oct 15 20:20:29 PDT 2026 added readFileEnds()
+// Filename:      mapfile.c
+// Syntax:        C
+//
+// Description:   Read-only access to the complete contents of an input
+//                file, using mmap() when available, or to only the
+//                bytes at the start and end of the file.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mapfile.h"
+
+#ifdef _WIN32
+	#define MAPFILE_NO_MMAP
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+
+
+//////////////////////////////
+//
+// mapInputFile -- Map the contents of an input file into memory.
+//    The file is read with a single read() on systems without mmap().
+//    Returns NULL if the file cannot be opened.
+//
+
+const unsigned char* mapInputFile(const char* filename, size_t* length) {
+#ifdef MAPFILE_NO_MMAP
+	FILE* input = fopen(filename, "rb");
+	if (input == NULL) {
+		return NULL;
+	}
+	fseek(input, 0, SEEK_END);
+	long filesize = ftell(input);
+	rewind(input);
+	if (filesize < 0) {
+		fclose(input);
+		return NULL;
+	}
+	unsigned char* data = (unsigned char*)malloc(filesize > 0 ? filesize : 1);
+	if ((data == NULL) || (fread(data, 1, filesize, input) != (size_t)filesize)) {
+		free(data);
+		fclose(input);
+		return NULL;
+	}
+	fclose(input);
+	*length = (size_t)filesize;
+	return data;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return NULL;
+	}
+	*length = (size_t)info.st_size;
+	if (*length == 0) {
+		// mmap() does not accept empty files, so return a valid
+		// pointer to no data.
+		close(fd);
+		return (const unsigned char*)"";
+	}
+	void* data = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+	return (const unsigned char*)data;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// unmapInputFile -- Release the memory returned by mapInputFile().
+//
+
+void unmapInputFile(const unsigned char* data, size_t length) {
+#ifdef MAPFILE_NO_MMAP
+	free((void*)data);
+#else
+	if (length > 0) {
+		munmap((void*)data, length);
+	}
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// readFileEnds -- Read the first headSize bytes and the last tailSize
+//    bytes of a file (or fewer if the file is smaller), and store the
+//    size of the file in length.  Only these bytes are read (with
+//    pread() when available), so that the count field and trailer of
+//    large numbers of files can be checked quickly.  Returns 0 if
+//    successful, or -1 if the file cannot be read.
+//
+
+int readFileEnds(const char* filename, unsigned char* head, size_t headSize,
+		unsigned char* tail, size_t tailSize, size_t* length) {
+#ifdef MAPFILE_NO_MMAP
+	FILE* input = fopen(filename, "rb");
+	if (input == NULL) {
+		return -1;
+	}
+	fseek(input, 0, SEEK_END);
+	long filesize = ftell(input);
+	if (filesize < 0) {
+		fclose(input);
+		return -1;
+	}
+	*length = (size_t)filesize;
+	if (headSize > *length) {
+		headSize = *length;
+	}
+	if (tailSize > *length) {
+		tailSize = *length;
+	}
+	int status = 0;
+	rewind(input);
+	if (fread(head, 1, headSize, input) != headSize) {
+		status = -1;
+	}
+	fseek(input, filesize - (long)tailSize, SEEK_SET);
+	if (fread(tail, 1, tailSize, input) != tailSize) {
+		status = -1;
+	}
+	fclose(input);
+	return status;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return -1;
+	}
+	*length = (size_t)info.st_size;
+	if (headSize > *length) {
+		headSize = *length;
+	}
+	if (tailSize > *length) {
+		tailSize = *length;
+	}
+	int status = 0;
+	if ((pread(fd, head, headSize, 0) != (ssize_t)headSize) ||
+			(pread(fd, tail, tailSize, (off_t)(*length - tailSize)) !=
+			(ssize_t)tailSize)) {
+		status = -1;
+	}
+	close(fd);
+	return status;
+#endif
+}
+
+
+
@@ -0,0 +1,27 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:04:30 PDT 2026
+// Last Modified: Thu Oct 15 20:04:30 PDT 2026 moved from mus2pmx.c
+// Last Modified: Thu Oct 15 20:20:29 PDT 2026 added readFileEnds()
+// Filename:      mapfile.h
+// Syntax:        C
+//
+// Description:   Read-only access to the complete contents of an input
+//                file, using mmap() when available, or to only the
+//                bytes at the start and end of the file.
+//
+
+#ifndef _MAPFILE_H_INCLUDED
+#define _MAPFILE_H_INCLUDED
+
+#include <stddef.h>
+
+const unsigned char* mapInputFile    (const char* filename, size_t* length);
+void                 unmapInputFile  (const unsigned char* data,
+                                      size_t length);
+int                  readFileEnds    (const char* filename,
+                                      unsigned char* head, size_t headSize,
+                                      unsigned char* tail, size_t tailSize,
+                                      size_t* length);
+
+#endif  /* _MAPFILE_H_INCLUDED */
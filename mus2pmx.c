@@ -3,6 +3,19 @@
 // Creation Date: Wed Aug 29 13:50:35 PDT 2012
 // Last Modified: Fri Feb 22 03:54:54 PST 2013 added EPS graphic item
 // Last Modified: Mon Mar 15 18:50:16 PDT 2021 added SCORE v3 file parsing
+// Last Modified: Thu Oct 15 19:43:22 PDT 2026 read input from memory map
+// Last Modified: Thu Oct 15 19:59:16 PDT 2026 fast number formatting
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026 decode parameters in blocks
+// Last Modified: Thu Oct 15 20:02:53 PDT 2026 added parallel batch mode
+// Last Modified: Thu Oct 15 20:08:34 PDT 2026 no limit on item length
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026 added conversion server
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026 conversion moved to libscore
+// Last Modified: Thu Oct 15 20:20:29 PDT 2026 added --info trailer probe
+// Last Modified: Thu Oct 15 20:27:09 PDT 2026 added --stats option
+// Last Modified: Thu Oct 15 20:29:08 PDT 2026 added --trace timeline
+// Last Modified: Thu Oct 15 20:30:43 PDT 2026 read from standard input
+// Last Modified: Thu Oct 15 20:33:08 PDT 2026 parallel conversion of large files
+// Last Modified: Thu Oct 15 20:38:08 PDT 2026 added --cache option
 // Filename:      mus2pmx.c
 // Syntax:        C
 //
@@ -15,49 +28,352 @@
 //                loaded into SCORE, but are useful for converting a
 //                movement from SCORE into another format).
 //
-// Usage:         mus2pmx file.mus [file2.mus] > file.pmx
+//                The input filename "-" reads a binary SCORE file from
+//                standard input (which can be a pipe).  With the --framed
+//                option, standard input contains any number of binary
+//                SCORE files, each preceded by its length as a 4-byte
+//                little-endian integer (as in the requests of the
+//                conversion server).  Each of them is converted as a
+//                separate page.  Only one input is stored in memory at
+//                a time, in a buffer which is reused for the next input.
 //
-// $Smake:        gcc -O3 -o mus2pmx -lm mus2pmx.c
+//                Large files (1 MB or more) which are converted to standard
+//                output are split into chunks of items, which are
+//                converted in parallel (see pipeline.h).  The -j option
+//                sets the number of threads, and -j 1 converts them with
+//                one thread.
+//
+//                In batch mode (the --outdir or --batch options), each
+//                input file is converted into a separate PMX file with
+//                the same basename.  Directory arguments are searched
+//                recursively for .mus and .pag files.  The files are
+//                converted in parallel, and an error in one file does
+//                not stop the conversion of the other files.
+//
+//                With the --cache option, batch mode only converts the
+//                files whose contents (or the conversion options) have
+//                changed since the manifest file of the cache was last
+//                saved, or whose output file was changed or removed (see
+//                cache.h).  The numbers of files which were up to date
+//                (hits) and which were converted (misses), and of stale
+//                manifest entries which were removed, are printed to
+//                standard error.
+//
+//                The --serve option starts a conversion server on a
+//                Unix-domain socket (see serve.h for the protocol).  Each
+//                request contains a binary SCORE file, which is converted
+//                into PMX data, or PMX data, which is converted into a
+//                binary SCORE file (as pmx2mus does).
+//
+//                The --info option prints the count field and trailer
+//                information of each input file (one line per file as
+//                tab-separated values, or as JSON with --format ndjson)
+//                without converting the files.  Only the first 4 bytes
+//                and the last 20 bytes of each file are read.
+//
+//                The --stats option writes statistics of the conversion
+//                to standard error (or as JSON to the file given with
+//                --stats-json): bytes read and written, the number of
+//                items of each P1 type, the time spent in each phase and
+//                the slowest files.  "decode" is the check of the count
+//                field and trailer, and "format" is the conversion of the
+//                items (without the time of the writes).
+//
+//                The --trace option writes a timeline of the conversion
+//                in the Trace Event JSON format (see trace.h), with a span
+//                for each file on the thread which converted it.  The span
+//                of a file contains spans for reading the file, checking
+//                the count and trailer, converting the items and flushing
+//                the output.
+//
+//                The conversion itself is done by libscore (see
+//                libscore.h).
+//
+// Usage:         mus2pmx [--stats] file.mus [file2.mus] > file.pmx
+//                mus2pmx [--framed] - < input > file.pmx
+//                mus2pmx --outdir dir [-j threads] file.mus|directory ...
+//                mus2pmx --batch [-j threads] file.mus|directory ...
+//                mus2pmx --cache manifest --outdir dir file.mus|directory ...
+//                mus2pmx --stats-json stats.json [--slowest n] --batch ...
+//                mus2pmx --trace trace.json --batch ...
+//                mus2pmx --serve socket [-j threads]
+//                mus2pmx --info [--format tsv|ndjson] [-j threads] file.mus|directory ...
+//
+// $Smake:        gcc -O3 -o mus2pmx mus2pmx.c workpool.c serve.c runstats.c trace.c pipeline.c cache.c libscore.a -lm -lpthread
 //
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
 #include <math.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "libscore.h"
+#include "workpool.h"
+#include "serve.h"
+#include "runstats.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "cache.h"
+
+#ifdef _WIN32
+	#include <io.h>
+	#include <fcntl.h>
+	#include <direct.h>
+	#define mkdir(path, mode) _mkdir(path)
+	#define strcasecmp        _stricmp
+#endif
+
+// List of input files for batch mode.  relative[i] is the path of
+// input[i] below the directory argument in which it was found (or
+// the filename without directory for file arguments).  output[i] is
+// the PMX filename, and duplicate[i] is the index of an earlier file
+// with the same output filename (or -1).
+typedef struct {
+	char** input;
+	char** relative;
+	char** output;
+	int*   duplicate;
+	int    count;
+	int    capacity;
+} FileList;
+
+// Used for sorting the output filenames of a batch:
+typedef struct {
+	const char* filename;
+	int         index;
+} OutputName;
+
+// Shared settings for the threads of a batch conversion:
+typedef struct {
+	FileList*        files;
+	const char*      outdir;
+	ConversionCache* cache;     // NULL if --cache is not given
+	int              failures;
+	pthread_mutex_t  mutex;
+} BatchJob;
+
+// Trailer information of a block of files for the --info mode:
+typedef struct {
+	FileList*  files;
+	int        first;    // index of the first file of the block
+	ScoreData* scores;
+} InfoJob;
+
+// Number of files probed in parallel before their records are printed:
+#define INFO_BLOCK_SIZE 4096
+
+// Growable buffer for the PMX replies of the conversion server:
+typedef struct {
+	char*  text;
+	size_t length;     // length of the text
+	size_t capacity;   // allocated size of text
+} PmxBuffer;
+
+// Initial size of a PmxBuffer, which is doubled when it is full:
+#define PMX_BUFFER_SIZE 65536
+
+// Size of the reads from standard input when the length is not known:
+#define STDIN_BLOCK_SIZE (1 << 16)
+
+// Size of the output buffer of each file in batch mode (allocated on the
+// heap, since thread stacks may be small):
+#define BATCH_BUFFER_SIZE (1 << 16)
 
 // function declarations:
-void     printBinaryPageFileAsAscii  (const char* filename);
-int      readLittleShort             (FILE* input);
-int      readLittleInt               (FILE* input);
-double   readLittleFloat             (FILE* input);
-void     printItemParameters         (FILE* input, int count);
-void     printTextItem               (FILE* input, int count);
-void     printNumericItem            (FILE* input, int count);
-double   roundFractionDigits         (double number, int digits);
+int      printBinaryPageFileAsAscii  (const char* filename);
+int      convertMusFile              (PmxWriter* writer,
+                                      const char* filename);
+int      convertMusData              (PmxWriter* writer,
+                                      const unsigned char* data,
+                                      size_t size, const char* filename,
+                                      double start);
+int      convertMusDataWithStats     (PmxWriter* writer,
+                                      const unsigned char* data,
+                                      size_t size, const char* filename,
+                                      double start);
+int      convertStandardInput        (int framed);
+int      readStandardInput           (unsigned char** buffer,
+                                      size_t* capacity, size_t size,
+                                      size_t* length);
+int      setWriterError              (PmxWriter* writer,
+                                      const char* format, ...);
+int      appendToPmxOutput           (void* context, const char* text,
+                                      size_t size);
+int      reservePmxOutput            (PmxBuffer* buffer, size_t size);
+int      convertRequest              (const unsigned char* input,
+                                      size_t size, char** output,
+                                      size_t* outputSize);
+int      convertBatch                (int count, char** paths,
+                                      const char* outdir, int threads,
+                                      const char* cacheFile);
+void     convertBatchFile            (void* context, int index);
+void     collectInputFiles           (FileList* files, const char* path,
+                                      const char* relative, int recurse);
+void     addInputFile                (FileList* files, const char* path,
+                                      const char* relative);
+int      hasMusExtension             (const char* filename);
+char*    makeOutputFilename          (const char* input,
+                                      const char* relative,
+                                      const char* outdir);
+int      makeParentDirectories       (char* path);
+void     findDuplicateOutputs        (FileList* files);
+int      compareOutputs              (const void* a, const void* b);
+int      printFileInfo               (int count, char** paths, int json,
+                                      int threads);
+void     probeInfoFile               (void* context, int index);
+void     printInfoRecord             (const char* filename,
+                                      const ScoreData* score, int json);
+void     printJsonNumber             (const char* format, double number);
+void     usage                       (const char* command);
 
 int debugQ   = 0;  // turn on for debugging display
 int verboseQ = 1;  // turn on for seeing more info from trailer
 
+RunStats* runStats = NULL;  // statistics for the --stats option
+
+int pipelineThreads = 1;    // threads for converting one large file
+
+// Options of convertScoreToPmx() for the settings above:
+#define PMX_FLAGS ((verboseQ ? SCORE_PMX_HEADER : 0) | \
+		(debugQ ? SCORE_PMX_DEBUG : 0))
+
 ///////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
-	int i;
-	for (i=1; i<argc; i++) {
-		// If there are multiple input files print an information line
-		// showing the original filename for each page.
-		if (argc > 2) {
-			printf("##FILE:\t%s\n", argv[i]);
+	static struct option options[] = {
+		{ "outdir",     required_argument, NULL, 'o' },
+		{ "batch",      no_argument,       NULL, 'b' },
+		{ "jobs",       required_argument, NULL, 'j' },
+		{ "serve",      required_argument, NULL, 's' },
+		{ "info",       no_argument,       NULL, 'i' },
+		{ "format",     required_argument, NULL, 'f' },
+		{ "stats",      no_argument,       NULL, 'S' },
+		{ "stats-json", required_argument, NULL, 'J' },
+		{ "slowest",    required_argument, NULL, 'N' },
+		{ "trace",      required_argument, NULL, 'T' },
+		{ "framed",     no_argument,       NULL, 'F' },
+		{ "cache",      required_argument, NULL, 'C' },
+		{ "help",       no_argument,       NULL, 'h' },
+		{ NULL,         0,                 NULL, 0   }
+	};
+	const char* outdir    = NULL;
+	const char* server    = NULL;
+	const char* format    = "tsv";
+	const char* statsFile = NULL;
+	const char* traceFile = NULL;
+	const char* cacheFile = NULL;
+	int         batchQ    = 0;
+	int         infoQ     = 0;
+	int         statsQ    = 0;
+	int         framedQ   = 0;
+	int         slowest   = STATS_SLOWEST;
+	int         threads   = getProcessorCount();
+	int         opt;
+	while ((opt = getopt_long(argc, argv, "o:bj:s:if:h", options, NULL)) != -1) {
+		switch (opt) {
+			case 'o': outdir = optarg; batchQ = 1; break;
+			case 'b': batchQ = 1;                  break;
+			case 'j': threads = atoi(optarg);      break;
+			case 's': server = optarg;             break;
+			case 'i': infoQ = 1;                   break;
+			case 'f': format = optarg;             break;
+			case 'S': statsQ = 1;                  break;
+			case 'J': statsFile = optarg;          break;
+			case 'N': slowest = atoi(optarg);      break;
+			case 'T': traceFile = optarg;          break;
+			case 'F': framedQ = 1;                 break;
+			case 'C': cacheFile = optarg;          break;
+			default:  usage(argv[0]);              exit(1);
 		}
+	}
+	int fileCount = argc - optind;
+	char** files  = argv + optind;
 
-		printBinaryPageFileAsAscii(argv[i]);
+	if (server != NULL) {
+		if ((fileCount > 0) || batchQ || statsQ || statsFile || traceFile ||
+				cacheFile) {
+			usage(argv[0]);
+			exit(1);
+		}
+		return runConversionServer(server, threads, convertRequest);
+	}
 
-		// Print "##PAGEBREAK" after every page execept the last one
-		// when there are multiple input files.
-		if ((i < argc-1) && (argc > 2)) {
-			printf("##PAGEBREAK\n");
+	if (infoQ) {
+		int json = (strcmp(format, "ndjson") == 0);
+		if ((fileCount < 1) || batchQ || statsQ || statsFile || traceFile ||
+				cacheFile || (!json && (strcmp(format, "tsv") != 0))) {
+			usage(argv[0]);
+			exit(1);
 		}
+		return printFileInfo(fileCount, files, json, threads) ? 1 : 0;
 	}
 
-	return 0;
+	int stdinQ = (fileCount == 1) && (strcmp(files[0], "-") == 0);
+	if ((batchQ && ((fileCount < 1) || stdinQ)) || (framedQ && !stdinQ) ||
+			(cacheFile && !batchQ)) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	RunStats stats;
+	if (statsQ || (statsFile != NULL)) {
+		initRunStats(&stats, "mus2pmx", slowest);
+		runStats = &stats;
+	}
+	if (traceFile != NULL) {
+		startTrace("mus2pmx");
+	}
+
+	int status = 0;
+	if (batchQ) {
+		status = convertBatch(fileCount, files, outdir, threads, cacheFile) ?
+				1 : 0;
+	} else if (stdinQ) {
+		pipelineThreads = threads;
+		setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+		status = convertStandardInput(framedQ) ? 1 : 0;
+	} else {
+		int i;
+		pipelineThreads = threads;
+		setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+		for (i=0; i<fileCount; i++) {
+			// If there are multiple input files print an information line
+			// showing the original filename for each page.
+			if (fileCount > 1) {
+				printf("##FILE:\t%s\n", files[i]);
+			}
+
+			if (printBinaryPageFileAsAscii(files[i]) != 0) {
+				status = 1;
+				break;
+			}
+
+			// Print "##PAGEBREAK" after every page execept the last one
+			// when there are multiple input files.
+			if ((i < fileCount-1) && (fileCount > 1)) {
+				printf("##PAGEBREAK\n");
+			}
+		}
+	}
+
+	if (runStats != NULL) {
+		fflush(stdout);
+		if (writeRunStats(runStats, statsFile) != 0) {
+			status = 1;
+		}
+		freeRunStats(runStats);
+	}
+	if ((traceFile != NULL) && (writeTrace(traceFile) != 0)) {
+		status = 1;
+	}
+	return status;
 }
 
 
@@ -74,233 +390,553 @@ int main(int argc, char** argv) {
 //    so it is optional to specify.  Binary files may have other extensions.
 //    ".pag" files are binary data files with the intention that they
 //    represent a page of music rather than a system line of music.
+//    If there is an error in the file, the error message is printed and
+//    -1 is returned.
 //
 
-void printBinaryPageFileAsAscii(const char* filename) {
-	FILE *input = fopen(filename, "r");
-	if (input == NULL) {
-		printf("Error: cannot open file %s for reading.\n", filename);
-		exit(1);
+int printBinaryPageFileAsAscii(const char* filename) {
+	PmxWriter writer;
+	writer.write    = writePmxToFile;
+	writer.context  = stdout;
+	writer.flags    = PMX_FLAGS;
+	writer.error[0] = '\0';
+	double start  = isTracing() ? getTraceTime() : 0.0;
+	int    status = convertMusFile(&writer, filename);
+	if (isTracing()) {
+		double flush = getTraceTime();
+		fflush(stdout);
+		double end = getTraceTime();
+		addTraceSpan("flush", NULL, flush, end);
+		addTraceSpan("file", filename, start, end);
 	}
-
-	int countFieldByteSize = 2;
-	// if the file size mod 4 has a remainder of 0, then the count field is
-	// four bytes instead of two (this only occurs with large WinScore files.
-	fseek(input, 0, SEEK_END);
-	int filesize = ftell(input);
-	rewind(input);
-	if (filesize % 4 == 0) {
-		countFieldByteSize = 4;
-	}
-
-	int numberCount = -1;
-	// First read the number of 4-byte numbers (or 4-character groupings)
-	// which are found in the file after this number.  The size of this
-	// number is 2 bytes for all files created with DOS versions of SCORE.
-	// For Windows versions of SCORE, it is possible that this number can
-	// be 4 bytes wide if the number of 4-byte values in the file exceeds
-	// 0xffff.
-	if (countFieldByteSize == 2) {
-		numberCount = readLittleShort(input);
-	} else {
-		numberCount = readLittleInt(input);
-	}
-	if (debugQ) {
-		printf("#number count is %d\n", numberCount);
+	if (status != 0) {
+		printf("%s\n", writer.error);
+		return -1;
 	}
+	return 0;
+}
 
-	// Process the trailer of the file.   First verify that this is
-	// a SCORE file since all SCORE binary files must end in the
-	// hex bytes "00 3c 1c c6" which represents the floating point
-	// number -9999.0.
-	fseek(input, -4, SEEK_END);
-	double lastNumber = readLittleFloat(input);
-	if (debugQ) {
-		printf("#trailer end number is %.1lf\n", lastNumber);
-	}
-	if (lastNumber != -9999.0) {
-		printf("Error: last number is not -9999.0: %.1lf\n", lastNumber);
-		exit(1);
-	}
 
-	// Now read the trailer of the file.  First go to 8 bytes before the
-	// end of the file and read how many bytes are in the trailer
-	// There should be at least 5 numbers. In reverse order from the
-	// end of the file, these are:
-	//    number 1: The number of floats in the trailer (including
-	//              this value.  Standard value is "5.0"  For future
-	//              versions of SCORE, this value might be larger, but
-	//              it will never be smaller.  Numbers 2, 3, and 4 will
-	//              always have a fixed meaning in any future versions
-	//              of SCORE, and extra parameters will be added before
-	//              them in the file if this value is larger than 5.0.
-	//    number 2: The measurement code: 0.0 = inches, 1.0 = centimeters.
-	//              This is needed for certain length measurements for
-	//              certain items (not often used).
-	//    number 3: Program version number which created the file.
-	//    number 4: Program serial number which created the file.
-	//    number 5: The last number in the trailer (i.e., the first
-	//              trailer byte within the file) must be set to 0.0;
-	//              This is an alternate way of identifying the trailer
-	//              after a list of items.  No item should have a
-	//              parameter size of 0.0, so a parameter size of 0.0
-	//              would indicate the end of the data and the start
-	//              of the trailer.
-
-	// Read number 1 (trailer size):
-	fseek(input, -8, SEEK_END);
-	double trailerSize = readLittleFloat(input);
-	if (debugQ) {
-		printf("#trailer size is %.1lf\n", trailerSize);
-	}
-	if (trailerSize < 4.0) {
-		printf("Error: trailer size is too small: %.1lf\n", trailerSize);
-		exit(1);
-	}
-	if (trailerSize > 5.0) {
-		printf("Error: trailer size is too large: %.1lf\n", trailerSize);
-		exit(1);
+
+//////////////////////////////
+//
+// convertMusFile -- Convert a binary SCORE file into PMX data written
+//    with the writer.  Returns 0 if successful, or -1 if there was an
+//    error, with the error message stored in the writer.
+//
+
+int convertMusFile(PmxWriter* writer, const char* filename) {
+	int    timed = (runStats != NULL) || isTracing();
+	double start = timed ? getStatsTime() : 0.0;
+	size_t filesize = 0;
+	const unsigned char* data = mapInputFile(filename, &filesize);
+	int status = convertMusData(writer, data, filesize, filename, start);
+	if (data != NULL) {
+		unmapInputFile(data, filesize);
 	}
+	return status;
+}
+
+
 
-	// Read number 2 (measurement units):
-	fseek(input, -12, SEEK_END);
-	double unitType = readLittleFloat(input);
-	if (debugQ) {
-		printf("#unit type is %.1lf\n", unitType);
+//////////////////////////////
+//
+// convertMusData -- Convert the mapped data of a binary SCORE file into
+//    PMX data written with the writer.  If data is NULL, the file could
+//    not be read.  start is the time when reading the file started (only
+//    used for --stats and --trace).  Returns 0 if successful, or -1 if
+//    there was an error, with the error message stored in the writer.
+//
+
+int convertMusData(PmxWriter* writer, const unsigned char* data,
+		size_t filesize, const char* filename, double start) {
+	int timed = (runStats != NULL) || isTracing();
+	if (data == NULL) {
+		setWriterError(writer, "Error: cannot open file %s for reading.",
+				filename);
+		return timed ? convertMusDataWithStats(writer, NULL, 0, filename,
+				start) : -1;
 	}
-	if (verboseQ) {
-		if (unitType == 0.0) {
-			printf("##UNITS:\tinches\n");
-		} else if (unitType == 0.0) {
-			printf("##UNITS:\tcentimeters\n");
+	return timed ?
+			convertMusDataWithStats(writer, data, filesize, filename, start) :
+			convertScoreToPmxPipelined(writer, data, filesize, pipelineThreads);
+}
+
+
+
+//////////////////////////////
+//
+// convertMusDataWithStats -- Same as convertScoreToPmx(), but also
+//    collect the statistics of the input for --stats and its spans for
+//    --trace.  start is the time when reading the input started.  If data
+//    is NULL, the input could not be read (and the error message is
+//    already stored in the writer), and only the failure is counted.
+//    The writes to the writer are timed separately from the rest of the
+//    conversion.
+//
+
+int convertMusDataWithStats(PmxWriter* writer, const unsigned char* data,
+		size_t filesize, const char* filename, double start) {
+	FileStats   stats;
+	StatsWriter output;
+	PmxWriter   timed = *writer;
+	int         status = -1;
+	beginFileStats(&stats, filename);
+
+	if (data != NULL) {
+		double time = addPhaseTime(&stats, STATS_READ, start);
+		addTraceSpan("read", NULL, start, time);
+		stats.bytesRead = filesize;
+		ScoreData score;
+		int       opened = openScoreData(&score, data, filesize);
+		start = time;
+		time  = addPhaseTime(&stats, STATS_DECODE, start);
+		addTraceSpan("trailer", NULL, start, time);
+
+		output.write    = writer->write;
+		output.context  = writer->context;
+		output.stats    = &stats;
+		timed.write     = writeWithStats;
+		timed.context   = &output;
+		timed.error[0]  = '\0';
+		// The same steps as convertScoreToPmx(), with the check of the
+		// count and trailer timed separately from the items.
+		if (opened != 0) {
+			setWriterError(&timed, "%s", score.error);
+		} else if (writePmxHeader(&timed, &score) == 0) {
+			status = countScoreItemsToPmx(&timed, &score, score.items,
+					score.itemsEnd, stats.items, STATS_P1_TYPES);
 		}
+		addTraceSpan("items", NULL, time,
+				addPhaseTime(&stats, STATS_FORMAT, time));
+		stats.seconds[STATS_FORMAT] -= stats.seconds[STATS_WRITE];
+		memcpy(writer->error, timed.error, sizeof(writer->error));
 	}
 
-	// Read number 3 (program version number):
-	fseek(input, -16, SEEK_END);
-	double versionNumber = readLittleFloat(input);
-	if (verboseQ) {
-		printf("##VERSION:\t%.2lf\n", versionNumber);
+	if (runStats != NULL) {
+		stats.failed = (status != 0);
+		addFileStats(runStats, &stats);
 	}
+	return status;
+}
+
 
-	if (trailerSize > 4.0) {
-		// Read number 4 (program serial number):
-		// SCORE version 4 (and higher) contains a serial
-		// number of the program used to create the data file.
-		fseek(input, -20, SEEK_END);
-		double serialNumber = readLittleFloat(input);
-		if (verboseQ) {
-			printf("##SERIAL:\t%lf\n", serialNumber);
+
+//////////////////////////////
+//
+// convertStandardInput -- Convert binary SCORE data read from standard
+//    input.  If framed is true, the input contains any number of files,
+//    each preceded by its length as a 4-byte little-endian integer, and
+//    a line starting with ##PAGEBREAK is printed between them.  Otherwise
+//    all of the input is one file.  Conversion stops at the first input
+//    with an error.  Returns 0 if successful.
+//
+
+int convertStandardInput(int framed) {
+	unsigned char* buffer   = NULL;
+	size_t         capacity = 0;
+	int            status   = 0;
+	int            page;
+	char           name[32];
+	PmxWriter      writer;
+	writer.write    = writePmxToFile;
+	writer.context  = stdout;
+	writer.flags    = PMX_FLAGS;
+	writer.error[0] = '\0';
+#ifdef _WIN32
+	_setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+	for (page=1; status == 0; page++) {
+		int    timed = (runStats != NULL) || isTracing();
+		double start = timed ? getStatsTime() : 0.0;
+		size_t size  = SIZE_MAX;
+		size_t length;
+		if (framed) {
+			unsigned char header[4];
+			size_t count = fread(header, 1, 4, stdin);
+			if ((count == 0) && !ferror(stdin)) {
+				break;
+			}
+			size = (size_t)header[0] | ((size_t)header[1] << 8) |
+					((size_t)header[2] << 16) | ((size_t)header[3] << 24);
+			if (count != 4) {
+				status = setWriterError(&writer,
+						"Error: incomplete length of input %d.", page);
+			} else if (size > SERVE_MAX_REQUEST) {
+				status = setWriterError(&writer,
+						"Error: input %d is too long (%zu bytes).", page, size);
+			}
+		}
+		if ((status == 0) &&
+				(readStandardInput(&buffer, &capacity, size, &length) != 0)) {
+			status = setWriterError(&writer,
+					"Error: cannot read input %d from standard input.", page);
+		} else if ((status == 0) && framed && (length < size)) {
+			status = setWriterError(&writer,
+					"Error: input %d has %zu bytes instead of %zu.", page,
+					length, size);
+		}
+		if (status != 0) {
+			printf("%s\n", writer.error);
+			break;
+		}
+
+		if (framed) {
+			snprintf(name, sizeof(name), "-:%d", page);
+		} else {
+			strcpy(name, "-");
+		}
+		if (page > 1) {
+			printf("##PAGEBREAK\n");
+		}
+		status = timed ?
+				convertMusDataWithStats(&writer, buffer, length, name, start) :
+				convertScoreToPmxPipelined(&writer, buffer, length,
+				pipelineThreads);
+		if (isTracing()) {
+			double flush = getTraceTime();
+			fflush(stdout);
+			double end = getTraceTime();
+			addTraceSpan("flush", NULL, flush, end);
+			addTraceSpan("file", name, start, end);
+		}
+		if (status != 0) {
+			printf("%s\n", writer.error);
+		}
+		if (!framed) {
+			break;
 		}
 	}
 
-	// Now that the file trailer has been processed, return to the start
-	// of the file (after the first number):
-	fseek(input, countFieldByteSize, SEEK_SET);
+	free(buffer);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// readStandardInput -- Read size bytes from standard input into the
+//    buffer, or everything until the end of the input if size is
+//    SIZE_MAX.  The buffer is enlarged if it is too small, and its size
+//    is stored in capacity.  The number of bytes read is stored in
+//    length (which is less than size at the end of the input).  Returns
+//    0 if successful, or -1 if out of memory or for a read error.
+//
 
-	// start reading items one at a time
-	double number = 0.0;
-	int readCount = 0;
-	while (!feof(input)) {
-		if (numberCount - readCount - (int)trailerSize - 1 == 0) {
-			// all expected numbers have been read from the file, so stop
-			// reading musical items.
+int readStandardInput(unsigned char** buffer, size_t* capacity, size_t size,
+		size_t* length) {
+	*length = 0;
+	while (*length < size) {
+		size_t wanted = (size == SIZE_MAX) ? *length + STDIN_BLOCK_SIZE : size;
+		if (wanted > *capacity) {
+			size_t larger = (size == SIZE_MAX) ? 2 * wanted : wanted;
+			unsigned char* data = (unsigned char*)realloc(*buffer, larger);
+			if (data == NULL) {
+				return -1;
+			}
+			*buffer   = data;
+			*capacity = larger;
+		}
+		size_t count = fread(*buffer + *length, 1, wanted - *length, stdin);
+		*length += count;
+		if (count == 0) {
 			break;
-		} else if (numberCount - readCount - (int)trailerSize - 1 < 0) {
-			printf("Error: item data overlaps with trailer contents\n");
-			exit(1);
 		}
+	}
+	return ferror(stdin) ? -1 : 0;
+}
 
-		number = readLittleFloat(input);
-		number = roundFractionDigits(number, 3);
-		readCount++;
-		if (number == 0.0) {
-			printf("Error: parameter size of next item is zero.\n");
-			exit(1);
+
+
+//////////////////////////////
+//
+// setWriterError -- Store an error message for the file being
+//     converted.  Returns -1 so that it can be used as a return value.
+//
+
+int setWriterError(PmxWriter* writer, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	vsnprintf(writer->error, sizeof(writer->error), format, args);
+	va_end(args);
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// convertRequest -- Convert a request for the conversion server.  Binary
+//     SCORE data (which always ends with -9999.0) is converted into PMX
+//     data, and anything else is treated as PMX data to be converted into
+//     binary SCORE data.  The result (or the error message) is returned
+//     in a new buffer.  Returns 0 if successful.
+//
+
+int convertRequest(const unsigned char* input, size_t size, char** output,
+		size_t* outputSize) {
+	static const unsigned char endMarker[4] = { 0x00, 0x3c, 0x1c, 0xc6 };
+	*output     = NULL;
+	*outputSize = 0;
+
+	if ((size >= 4) && (memcmp(input + size - 4, endMarker, 4) == 0)) {
+		PmxWriter writer;
+		PmxBuffer buffer = { NULL, 0, 0 };
+		writer.write    = appendToPmxOutput;
+		writer.context  = &buffer;
+		writer.flags    = PMX_FLAGS;
+		writer.error[0] = '\0';
+		// Start with a small buffer (so that an empty reply is not NULL),
+		// which grows with the text instead of with the request size.
+		if (reservePmxOutput(&buffer, 0) != 0) {
+			return -1;
 		}
-		if (debugQ) {
-			printf("# next item has %d parameters\n", (int)number);
+		int status = convertScoreToPmx(&writer, input, size);
+		if (status != 0) {
+			free(buffer.text);
+			*output     = strdup(writer.error);
+			*outputSize = *output ? strlen(*output) : 0;
+			return status;
 		}
-		readCount += (int)number;
-		printItemParameters(input, (int)number);
+		*output     = buffer.text;
+		*outputSize = buffer.length;
+		return 0;
 	}
 
-	if (fclose(input)) {
-		printf("Strange error when trying to close file %s.\n", filename);
-		exit(1);
+	ScoreBuilder builder;
+	const unsigned char* data;
+	size_t dataSize;
+	initScoreBuilder(&builder, size / 2 + 1024);
+	if ((convertPmxToScore((const char*)input, size, &builder) != 0) ||
+			(finishScoreData(&builder, &data, &dataSize) != 0)) {
+		freeScoreBuilder(&builder);
+		*output     = strdup("Error: out of memory for output data");
+		*outputSize = *output ? strlen(*output) : 0;
+		return -1;
 	}
+	// The file data starts after the unused bytes of the count field.
+	memmove(builder.data, data, dataSize);
+	*output     = (char*)builder.data;
+	*outputSize = dataSize;
+	return 0;
 }
 
 
 
 //////////////////////////////
 //
-// printItemParameters -- print the given number of parameters
-//    in the musical item at the current point in the file.
+// appendToPmxOutput -- Add more text to an output buffer (the write
+//     function for convertScoreToPmx(), with the buffer as the context),
+//     followed by a null character.  Returns -1 if the buffer cannot grow
+//     large enough for the text.
 //
 
-void printItemParameters(FILE* input, int count) {
-	// P1 == parameter 1, which is the item type
-	double P1           = readLittleFloat(input);
-	char   buffer[1024] = {0};
-	int    i;
-	if (P1 <= 0.0) {
-		printf("Strange error: P1 is non-positive: %lf\n", P1);
-		exit(1);
+int appendToPmxOutput(void* context, const char* text, size_t size) {
+	PmxBuffer* buffer = (PmxBuffer*)context;
+	if (reservePmxOutput(buffer, size) != 0) {
+		return -1;
 	}
-	if (P1 >= 100.0) {
-		printf("Strange error: P1 is way too large: %lf\n", P1);
-		exit(1);
+	memcpy(buffer->text + buffer->length, text, size);
+	buffer->length += size;
+	buffer->text[buffer->length] = '\0';
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// reservePmxOutput -- Make sure that an output buffer has space for
+//     size more bytes and a null character.  The buffer size is doubled
+//     when it needs to grow.  Returns -1 if out of memory (the buffer is
+//     then unchanged).
+//
+
+int reservePmxOutput(PmxBuffer* buffer, size_t size) {
+	size_t needed = buffer->length + size + 1;
+	if (needed <= buffer->capacity) {
+		return 0;
 	}
-	if (P1 == 16.0) {
-		// text items use "t" instead of "16.0" for the first parameter
-		// in the item when displaying as ASCII PMX data.
-		printf("t     ");
-		printTextItem(input, count-1);
-	} else if (P1 == 15.0) {
-		// print EPS graphic item
-		// The first 13 4-byte words are numeric parameters
-		// Parameter 13 should probably not be printed in the PMX data
-		// since it is only used to edit the filename in the SCORE editor.
-		if (count < 13) {
-			printf("Error: EPS graphic item has too few parameters\n");
-			exit(1);
-		}
-		printf("%2.3lf", P1);
-		printNumericItem(input, 12);
-		// Read the remaining bytes into a string to print as the EPS filename.
-		count = count - 13;
-		if (count <= 0) {
-			printf("Error: expecting non-zero count for P1=15 filename\n");
-			exit(1);
-		}
-		if (fread((void*)buffer, sizeof(char), count*4, input) == EOF) {
-			printf("Error while trying to read text string.\n");
+	size_t capacity = buffer->capacity ? 2 * buffer->capacity : PMX_BUFFER_SIZE;
+	if (capacity < needed) {
+		capacity = needed;
+	}
+	char* larger = (char*)realloc(buffer->text, capacity);
+	if (larger == NULL) {
+		return -1;
+	}
+	buffer->text     = larger;
+	buffer->capacity = capacity;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// convertBatch -- Convert each input file (or each .mus/.pag file found
+//    in directory arguments) into a separate PMX file.  If outdir is NULL,
+//    the PMX file is written next to the input file.  Otherwise it is
+//    written to outdir, with the subdirectories of directory arguments
+//    recreated in outdir.  Errors are reported on stderr for each file.
+//    If cacheFile is not NULL, files with up-to-date output are skipped
+//    (see cache.h).  Returns the number of files which could not be
+//    converted (plus one if the cache manifest could not be written).
+//
+
+int convertBatch(int count, char** paths, const char* outdir, int threads,
+		const char* cacheFile) {
+	FileList files = { NULL, NULL, NULL, NULL, 0, 0 };
+	int i;
+	for (i=0; i<count; i++) {
+		collectInputFiles(&files, paths[i], NULL, 1);
+	}
+	files.output    = (char**)malloc((files.count + 1) * sizeof(char*));
+	files.duplicate = (int*)malloc((files.count + 1) * sizeof(int));
+	for (i=0; i<files.count; i++) {
+		files.output[i] = makeOutputFilename(files.input[i], files.relative[i],
+				outdir);
+	}
+	findDuplicateOutputs(&files);
+
+	ConversionCache cache;
+	char            options[64];
+	if (cacheFile != NULL) {
+		snprintf(options, sizeof(options), "mus2pmx %s flags %d",
+				SCORE_LIBRARY_VERSION, PMX_FLAGS);
+		if (openConversionCache(&cache, cacheFile, options, files.count) != 0) {
+			fprintf(stderr, "Error: out of memory for cache %s\n", cacheFile);
 			exit(1);
 		}
-		buffer[count*4] = '\0';
-		// remove any trailing spaces in filename
-		for (i=count*4-1; i>=0; i--) {
-			if (buffer[i] == 0x20) {
-				buffer[i] = '\0';
-			} else {
-				break;
-			}
+	}
+
+	BatchJob job;
+	job.files    = &files;
+	job.outdir   = outdir;
+	job.cache    = cacheFile ? &cache : NULL;
+	job.failures = 0;
+	pthread_mutex_init(&job.mutex, NULL);
+
+	runWorkPool(threads, files.count, convertBatchFile, &job);
+
+	pthread_mutex_destroy(&job.mutex);
+	if (job.failures > 0) {
+		fprintf(stderr, "mus2pmx: %d of %d files could not be converted\n",
+				job.failures, files.count);
+	}
+	int status = job.failures;
+	if (cacheFile != NULL) {
+		if (saveConversionCache(&cache) != 0) {
+			status++;
 		}
-		printf("%s\n", buffer);
+		fprintf(stderr, "mus2pmx: cache: %d hits, %d misses, %d evicted\n",
+				cache.hits, cache.misses, cache.evicted);
+		freeConversionCache(&cache);
+	}
+	for (i=0; i<files.count; i++) {
+		free(files.input[i]);
+		free(files.relative[i]);
+		free(files.output[i]);
+	}
+	free(files.input);
+	free(files.relative);
+	free(files.output);
+	free(files.duplicate);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// convertBatchFile -- Convert one of the files in a batch conversion
+//    (called from the threads of the work pool).  An incomplete output
+//    file is removed if there is an error.  With a cache, the file is
+//    not converted if its output file is up to date.  The input is
+//    mapped once for both the cache hash and the conversion, so the
+//    "read" phase of --stats also contains the hash and the opening of
+//    the output file.
+//
+
+void convertBatchFile(void* context, int index) {
+	BatchJob*   job       = (BatchJob*)context;
+	const char* input     = job->files->input[index];
+	char*       filename  = job->files->output[index];
+	int         duplicate = job->files->duplicate[index];
+	PmxWriter   writer;
+	FILE*       file;
+	char*       buffer = NULL;
+	int         timed = (runStats != NULL) || isTracing();
+	double      start = timed ? getStatsTime() : 0.0;
+	uint64_t    hash  = 0;
+	size_t      filesize = 0;
+	const unsigned char* data = mapInputFile(input, &filesize);
+	int         cached;
+	writer.write    = writePmxToFile;
+	writer.context  = NULL;
+	writer.flags    = PMX_FLAGS;
+	writer.error[0] = '\0';
+	// Unreadable input files are not cached, and fail in convertMusData().
+	cached = (job->cache != NULL) && (data != NULL);
+	if (cached) {
+		hash = hashCacheData(data, filesize);
+	}
+
+	if (strcmp(filename, input) == 0) {
+		setWriterError(&writer,
+				"Error: output file would overwrite input file.");
+	} else if (duplicate >= 0) {
+		setWriterError(&writer,
+				"Error: output file %s is already written for %s.", filename,
+				job->files->input[duplicate]);
+	} else if (cached && checkCacheEntry(job->cache, index, filename, hash)) {
+		// The output file is up to date.
+	} else if ((job->outdir != NULL) && (makeParentDirectories(filename) != 0)) {
+		setWriterError(&writer,
+				"Error: cannot create directory for %s: %s.", filename,
+				strerror(errno));
+	} else if ((file = fopen(filename, "w")) == NULL) {
+		setWriterError(&writer,
+				"Error: cannot open file %s for writing.", filename);
 	} else {
-		// Print non-text items.
-		if (P1 < 10) {
-			// The first character on the line for a PMX should not be a space.
-			// The fractional value is usually not used (always .0000).  But
-			// Walter's data and the newest Windows SCORE files may contain
-			// non-zero fraction digits which describe the layer number of
-			// the items on the staff.
-			printf("%1.4lf", P1);
+		buffer = (char*)malloc(BATCH_BUFFER_SIZE);
+		if (buffer != NULL) {
+			setvbuf(file, buffer, _IOFBF, BATCH_BUFFER_SIZE);
+		}
+		writer.context = file;
+		if (convertMusData(&writer, data, filesize, input, start) != 0) {
+			fclose(file);
+			remove(filename);
 		} else {
-			printf("%2.3lf", P1);
+			double flush  = isTracing() ? getTraceTime() : 0.0;
+			int    status = fclose(file);
+			if (isTracing()) {
+				addTraceSpan("flush", NULL, flush, getTraceTime());
+			}
+			if (status != 0) {
+				setWriterError(&writer, "Error: cannot write file %s.",
+						filename);
+				remove(filename);
+			} else if (cached) {
+				storeCacheEntry(job->cache, index, filename, hash);
+			}
 		}
-		printNumericItem(input, count-1);
+	}
+	free(buffer);
+	if (data != NULL) {
+		unmapInputFile(data, filesize);
+	}
+	if (isTracing()) {
+		addTraceSpan("file", input, start, getTraceTime());
+	}
+
+	if (writer.error[0] != '\0') {
+		pthread_mutex_lock(&job->mutex);
+		fprintf(stderr, "%s: %s\n", input, writer.error);
+		job->failures++;
+		pthread_mutex_unlock(&job->mutex);
 	}
 }
 
@@ -308,164 +944,379 @@ void printItemParameters(FILE* input, int count) {
 
 //////////////////////////////
 //
-// printTextItem -- print a P1=16 item, starting with P2 value.
+// collectInputFiles -- Add a file to the list, or if the path is a
+//    directory, all .mus and .pag files found in it and its
+//    subdirectories.  Paths which cannot be read are added to the
+//    list so that the error is reported when converting them.
 //
 
-void printTextItem(FILE* input, int count) {
-	int i;
-	double number;
-	if (count < 12) {
-		printf("Error reading binary text item: there must be 13 fixed ");
-		printf("parameters, but there are instead %d.\n", count);
-		exit(1);
+void collectInputFiles(FileList* files, const char* path,
+		const char* relative, int recurse) {
+	struct stat info;
+	if ((stat(path, &info) != 0) || !S_ISDIR(info.st_mode)) {
+		if (relative == NULL) {
+			// file argument: only keep the filename for the output
+			const char* slash = strrchr(path, '/');
+			relative = slash ? slash + 1 : path;
+			addInputFile(files, path, relative);
+		} else if (hasMusExtension(path)) {
+			addInputFile(files, path, relative);
+		}
+		return;
+	}
+	if (!recurse) {
+		return;
 	}
 
-	// First print the fixed parameters for the text item:
-	int characterCount = -1;
-	for (i=0; i<12; i++) {
-		number = readLittleFloat(input);
-		number = roundFractionDigits(number, 3);
-		printf(" %8.3lf", number);
-		if (i == 10) {
-			// P12 is the number of characters in the string which follows.
-			characterCount = (int)number;
+	DIR* directory = opendir(path);
+	if (directory == NULL) {
+		addInputFile(files, path, relative ? relative : "");
+		return;
+	}
+	struct dirent* entry;
+	while ((entry = readdir(directory)) != NULL) {
+		if (entry->d_name[0] == '.') {
+			// skip ".", ".." and hidden files
+			continue;
 		}
+		size_t plen = strlen(path);
+		size_t rlen = relative ? strlen(relative) : 0;
+		size_t nlen = strlen(entry->d_name);
+		char* child = (char*)malloc(plen + nlen + 2);
+		char* childRelative = (char*)malloc(rlen + nlen + 2);
+		sprintf(child, "%s%s%s", path,
+				(plen > 0) && (path[plen-1] == '/') ? "" : "/", entry->d_name);
+		sprintf(childRelative, "%s%s%s", rlen ? relative : "", rlen ? "/" : "",
+				entry->d_name);
+		collectInputFiles(files, child, childRelative, 1);
+		free(child);
+		free(childRelative);
 	}
-	printf("\n");
+	closedir(directory);
+}
+
+
 
-	if (debugQ) {
-		printf("# String length is %d\n", characterCount);
+//////////////////////////////
+//
+// addInputFile -- Append a file to the list of input files.
+//
+
+void addInputFile(FileList* files, const char* path, const char* relative) {
+	if (files->count >= files->capacity) {
+		files->capacity = files->capacity ? 2 * files->capacity : 64;
+		files->input    = (char**)realloc(files->input,
+				files->capacity * sizeof(char*));
+		files->relative = (char**)realloc(files->relative,
+				files->capacity * sizeof(char*));
+		if ((files->input == NULL) || (files->relative == NULL)) {
+			fprintf(stderr, "mus2pmx: out of memory\n");
+			exit(1);
+		}
 	}
+	files->input[files->count]    = strdup(path);
+	files->relative[files->count] = strdup(relative);
+	files->count++;
+}
 
-	char buffer[1024] = {0};
-	if (fread((void*)buffer, sizeof(char), characterCount, input) == EOF) {
-		printf("Error while trying to read text string.\n");
-		exit(1);
+
+
+//////////////////////////////
+//
+// hasMusExtension -- Returns true if the filename ends in .mus or .pag
+//     (in upper or lower case).
+//
+
+int hasMusExtension(const char* filename) {
+	const char* extension = strrchr(filename, '.');
+	if (extension == NULL) {
+		return 0;
 	}
-	buffer[characterCount] = '\0';
-	printf("%s\n", buffer);
+	return (strcasecmp(extension, ".mus") == 0) ||
+			(strcasecmp(extension, ".pag") == 0);
+}
+
+
 
-	// Next, read extra padding bytes, since the length of the string
-	// field must be a multiple of 4.  These padding bytes should be
-	// spaces, but can occasionally be non-zero, so just ignore the
-	// padding bytes.
-	int extraBytes = characterCount % 4;
-	if (debugQ) {
-		printf("#Extra padding bytes after string is %d\n", 4-extraBytes);
+//////////////////////////////
+//
+// makeOutputFilename -- Replace the extension of the input file with
+//    .pmx, either next to the input file, or in outdir (using the
+//    relative path of the input file).  The returned string must be
+//    freed by the caller.
+//
+
+char* makeOutputFilename(const char* input, const char* relative,
+		const char* outdir) {
+	const char* base = outdir ? relative : input;
+	size_t      olen = outdir ? strlen(outdir) + 1 : 0;
+	char*       filename = (char*)malloc(olen + strlen(base) + 5);
+	if (filename == NULL) {
+		fprintf(stderr, "mus2pmx: out of memory\n");
+		exit(1);
 	}
-	int bytecount;
-	if ((extraBytes > 0) && (extraBytes < 4)) {
-		bytecount = fread((void*)buffer, sizeof(char), 4-extraBytes, input);
-		buffer[4-extraBytes] = '\0';
+	if (outdir) {
+		sprintf(filename, "%s/%s", outdir, base);
+	} else {
+		strcpy(filename, base);
+	}
+
+	// Only remove an extension in the filename, not in a directory name:
+	char* slash = strrchr(filename, '/');
+	char* dot   = strrchr(filename, '.');
+	if ((dot != NULL) && ((slash == NULL) || (dot > slash + 1))) {
+		*dot = '\0';
 	}
+	strcat(filename, ".pmx");
+	return filename;
 }
 
 
 
 //////////////////////////////
 //
-// printNumericItem -- print a P1!=16 item, starting with P2 value.
-//    Also, PostScript items should probably not be printed with this
-//    function (but currently are).
+// findDuplicateOutputs -- Mark files which would be written to the
+//     same output file as an earlier input file in the list (such as
+//     two input files with the same name in different directories).
 //
 
-void printNumericItem(FILE* input, int count) {
+void findDuplicateOutputs(FileList* files) {
+	OutputName* names = (OutputName*)malloc((files->count + 1) *
+			sizeof(OutputName));
 	int i;
-	double number;
-	for (i=0; i<count; i++) {
-		number = readLittleFloat(input);
-		number = roundFractionDigits(number, 3);
-		printf(" %8.3lf", number);
+	for (i=0; i<files->count; i++) {
+		names[i].filename = files->output[i];
+		names[i].index    = i;
+		files->duplicate[i] = -1;
 	}
-	printf("\n");
+	// Sort by output filename and then by input order:
+	qsort(names, files->count, sizeof(OutputName), compareOutputs);
+	for (i=1; i<files->count; i++) {
+		if (strcmp(names[i].filename, names[i-1].filename) == 0) {
+			files->duplicate[names[i].index] = names[i-1].index;
+		}
+	}
+	free(names);
 }
 
 
 
 //////////////////////////////
 //
-// readLittleShort -- Read a (two-byte) unsigned short at the current
-//   read position in a file that is stored in the file in little-endian
-//   ordering.
+// compareOutputs -- Sorting function for findDuplicateOutputs().
 //
 
-int readLittleShort(FILE* input) {
-	unsigned char byteinfo[2];
-	if (fread((void*)byteinfo, sizeof(unsigned char), 2, input) == EOF) {
-		printf("Error reading little-endian float: unexpected end of file\n");
-		exit(1);
+int compareOutputs(const void* a, const void* b) {
+	const OutputName* na = (const OutputName*)a;
+	const OutputName* nb = (const OutputName*)b;
+	int result = strcmp(na->filename, nb->filename);
+	if (result == 0) {
+		result = na->index - nb->index;
 	}
-	int output = 0;
-	output = byteinfo[1];
-	output = (output << 8) | byteinfo[0];
-	return output;
+	return result;
 }
 
 
 
 //////////////////////////////
 //
-// readLittleInt -- Read a (four-byte) unsigned int at the current
-//   read position in a file that is stored in the file in little-endian
-//   ordering.
+// makeParentDirectories -- Create the directories leading to a file
+//     (like "mkdir -p").  Returns 0 if successful.
 //
 
-int readLittleInt(FILE* input) {
-	unsigned char byteinfo[4];
-	if (fread((void*)byteinfo, sizeof(unsigned char), 4, input) == EOF) {
-		printf("Error reading little-endian float: unexpected end of file\n");
-		exit(1);
+int makeParentDirectories(char* path) {
+	char* ptr;
+	for (ptr=path+1; *ptr; ptr++) {
+		if (*ptr != '/') {
+			continue;
+		}
+		*ptr = '\0';
+		int status = mkdir(path, 0777);
+		int error  = errno;
+		*ptr = '/';
+		if ((status != 0) && (error != EEXIST)) {
+			errno = error;
+			return -1;
+		}
 	}
-	int output = 0;
-	output = byteinfo[3];
-	output = (output << 8) | byteinfo[2];
-	output = (output << 8) | byteinfo[1];
-	output = (output << 8) | byteinfo[0];
-	return output;
+	return 0;
 }
 
 
 
 //////////////////////////////
 //
-// readLittleFloat -- Read a (four-byte) signed float at the
-//     current position in a file, and which is stored in the file
-//     in little-endian ordering.
+// printFileInfo -- Print the count field and trailer information of
+//    each input file (or each .mus/.pag file found in directory
+//    arguments), without reading the items of the files.  The files are
+//    probed in parallel, and the records are printed in the order of
+//    the input files.  Returns the number of files which are not valid
+//    SCORE files.
 //
 
-double readLittleFloat(FILE* input) {
-	unsigned char byteinfo[4];
-	if (fread((void*)byteinfo, sizeof(unsigned char), 4, input) == EOF) {
-		printf("Error reading little-endian float: unexpected end of file\n");
+int printFileInfo(int count, char** paths, int json, int threads) {
+	FileList files = { NULL, NULL, NULL, NULL, 0, 0 };
+	int i;
+	for (i=0; i<count; i++) {
+		collectInputFiles(&files, paths[i], NULL, 1);
+	}
+
+	InfoJob job;
+	job.files  = &files;
+	job.scores = (ScoreData*)malloc(INFO_BLOCK_SIZE * sizeof(ScoreData));
+	if (job.scores == NULL) {
+		fprintf(stderr, "mus2pmx: out of memory\n");
 		exit(1);
 	}
-	union { float f; unsigned int i; } num;
-	num.i = 0;
-	num.i = byteinfo[3];
-	num.i = (num.i << 8) | byteinfo[2];
-	num.i = (num.i << 8) | byteinfo[1];
-	num.i = (num.i << 8) | byteinfo[0];
-	return num.f;
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+	if (!json) {
+		printf("file\tsize\tcountsize\twords\ttrailersize\tunits\tversion"
+				"\tserial\terror\n");
+	}
+
+	int failures = 0;
+	for (job.first=0; job.first<files.count; job.first+=INFO_BLOCK_SIZE) {
+		int blockSize = files.count - job.first;
+		if (blockSize > INFO_BLOCK_SIZE) {
+			blockSize = INFO_BLOCK_SIZE;
+		}
+		runWorkPool(threads, blockSize, probeInfoFile, &job);
+		for (i=0; i<blockSize; i++) {
+			printInfoRecord(files.input[job.first + i], &job.scores[i], json);
+			if (job.scores[i].error[0] != '\0') {
+				failures++;
+			}
+		}
+	}
+	fflush(stdout);
+
+	for (i=0; i<files.count; i++) {
+		free(files.input[i]);
+		free(files.relative[i]);
+	}
+	free(files.input);
+	free(files.relative);
+	free(job.scores);
+	return failures;
+}
+
+
+
+//////////////////////////////
+//
+// probeInfoFile -- Work function for printFileInfo(): read the count
+//     field and trailer of one file in the current block.
+//
+
+void probeInfoFile(void* context, int index) {
+	InfoJob* job = (InfoJob*)context;
+	probeScoreFile(&job->scores[index], job->files->input[job->first + index]);
 }
 
 
 
 //////////////////////////////
 //
-// roundFractionDigits -- Round a floating-point number to the speicified
-//    number of siginificant digits after the decimal point.  SCORE binary
-//    values are floats, and they usually contain (roundoff?) junk after
-//    the third digit after the decimal point.
+// printInfoRecord -- Print the trailer information of a file as a line of
+//     tab-separated values or as a JSON object.  The fields are empty
+//     (or null) if the file is not a valid SCORE file, and the serial
+//     number is empty for 4-number trailers.
 //
 
-double roundFractionDigits(double number, int digits) {
-	double dshift = pow(10.0, digits);
-	if (number < 0.0) {
-		return ((int)(number * dshift - 0.5))/dshift;
+void printInfoRecord(const char* filename, const ScoreData* score,
+		int json) {
+	int valid  = (score->error[0] == '\0');
+	int serial = valid && (score->trailerSize > 4.0);
+	if (!json) {
+		printf("%s\t", filename);
+		if (valid) {
+			printf("%lu\t%d\t%d\t%g\t%g\t%.2lf\t", (unsigned long)score->size,
+					score->countSize, score->numberCount, score->trailerSize,
+					score->units, score->version);
+		} else {
+			printf("\t\t\t\t\t\t");
+		}
+		if (serial) {
+			printf("%lf", score->serial);
+		}
+		printf("\t%s\n", score->error);
+		return;
+	}
+
+	printf("{\"file\":");
+	writeJsonString(stdout, filename);
+	if (valid) {
+		printf(",\"size\":%lu,\"countSize\":%d,\"words\":%d",
+				(unsigned long)score->size, score->countSize, score->numberCount);
+		printJsonNumber(",\"trailerSize\":%g", score->trailerSize);
+		printJsonNumber(",\"units\":%g", score->units);
+		printJsonNumber(",\"version\":%.2lf", score->version);
+		if (serial) {
+			printJsonNumber(",\"serial\":%lf", score->serial);
+		} else {
+			printf(",\"serial\":null");
+		}
+		printf(",\"error\":null}\n");
 	} else {
-		return ((int)(number * dshift + 0.5))/dshift;
+		printf(",\"error\":");
+		writeJsonString(stdout, score->error);
+		printf("}\n");
 	}
 }
 
 
 
+//////////////////////////////
+//
+// printJsonNumber -- Print a number with the given format, or null if
+//     the number is NaN or infinite (which cannot be stored in JSON).
+//
+
+void printJsonNumber(const char* format, double number) {
+	if (isfinite(number)) {
+		printf(format, number);
+	} else {
+		printf("%.*snull", (int)(strchr(format, '%') - format), format);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// usage -- Print the command-line options.
+//
+
+void usage(const char* command) {
+	fprintf(stderr, "Usage: %s file.mus [file2.mus ...] > file.pmx\n", command);
+	fprintf(stderr, "       %s [--framed] - < input > file.pmx\n", command);
+	fprintf(stderr, "       %s --outdir dir [-j threads] [--cache file] "
+			"file.mus|directory ...\n", command);
+	fprintf(stderr, "       %s --batch [-j threads] [--cache file] "
+			"file.mus|directory ...\n", command);
+	fprintf(stderr, "       %s --serve socket [-j threads]\n", command);
+	fprintf(stderr, "       %s --info [--format tsv|ndjson] [-j threads] "
+			"file.mus|directory ...\n", command);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "   --framed          standard input (-) contains files which are\n");
+	fprintf(stderr, "                     each preceded by a 4-byte little-endian length\n");
+	fprintf(stderr, "   -o, --outdir dir  write a .pmx file for each input into dir\n");
+	fprintf(stderr, "   -b, --batch       write a .pmx file next to each input file\n");
+	fprintf(stderr, "   -j, --jobs n      number of threads for batch conversion\n");
+	fprintf(stderr, "                     or for serving clients or for converting\n");
+	fprintf(stderr, "                     large files\n");
+	fprintf(stderr, "                     (default: number of processor cores)\n");
+	fprintf(stderr, "   -s, --serve path  run a conversion server on a Unix socket\n");
+	fprintf(stderr, "   -i, --info        print the trailer information of each file\n");
+	fprintf(stderr, "   -f, --format fmt  --info output as tsv (default) or ndjson\n");
+	fprintf(stderr, "   --stats           write statistics of the conversion to stderr\n");
+	fprintf(stderr, "   --stats-json file write the statistics to file as JSON\n");
+	fprintf(stderr, "   --slowest n       number of slowest files in the statistics\n");
+	fprintf(stderr, "                     (default: %d)\n", STATS_SLOWEST);
+	fprintf(stderr, "   --trace file      write a timeline of the conversion to file\n");
+	fprintf(stderr, "   --cache file      only convert changed files in batch mode,\n");
+	fprintf(stderr, "                     with a manifest of the outputs in file\n");
+}
+
+
+
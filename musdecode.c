@@ -0,0 +1,300 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:00:52 PDT 2026
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026
+// Last Modified: Thu Oct 15 20:46:35 PDT 2026 added wasm SIMD128 version
+// Filename:      musdecode.c
+// Syntax:        C
+//
+// Description:   Decode blocks of little-endian floats from binary SCORE
+//                data.  SSE2 and AVX2 versions are used on x86-64, and a
+//                SIMD128 version in WebAssembly builds compiled with
+//                -msimd128 (see ../docs/Makefile), with a portable scalar
+//                version for other systems.
+//
+//                The parameters of an item are stored as consecutive
+//                4-byte floats, so all parameters of an item can be
+//                converted at once.  decodeRoundedParameters() converts
+//                each float into the integer number of thousandths that
+//                roundFractionDigits(number, 3) rounds the value to.
+//                The SIMD versions do the same double-precision arithmetic
+//                as the scalar version, so the results are identical.
+//
+
+#include <string.h>
+#include <stdint.h>
+
+#include "musdecode.h"
+#include "pmxformat.h"
+
+#if defined(__wasm_simd128__)
+	#define MUSDECODE_WASM
+	#include <wasm_simd128.h>
+#elif defined(__x86_64__) && defined(__SSE2__) && \
+		(defined(__GNUC__) || defined(__clang__))
+	#define MUSDECODE_X86
+	#include <immintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	#define MUSDECODE_LITTLE_ENDIAN
+#endif
+
+// function declarations:
+static int      decodeRoundedScalar   (int32_t* output,
+                                       const unsigned char* input, int count);
+static float    loadLittleFloat       (const unsigned char* input);
+#ifdef MUSDECODE_X86
+static int      decodeRoundedSse2     (int32_t* output,
+                                       const unsigned char* input, int count);
+static int      decodeRoundedAvx2     (int32_t* output,
+                                       const unsigned char* input, int count);
+static int      hasAvx2               (void);
+#endif
+#ifdef MUSDECODE_WASM
+static int      decodeRoundedWasm     (int32_t* output,
+                                       const unsigned char* input, int count);
+#endif
+
+
+
+//////////////////////////////
+//
+// decodeLittleFloats -- Convert count 4-byte little-endian floats
+//    into native floats.
+//
+
+void decodeLittleFloats(float* output, const unsigned char* input, int count) {
+#ifdef MUSDECODE_LITTLE_ENDIAN
+	memcpy(output, input, (size_t)count * 4);
+#else
+	int i;
+	for (i=0; i<count; i++) {
+		output[i] = loadLittleFloat(input + 4 * i);
+	}
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// decodeRoundedParameters -- Convert count 4-byte little-endian floats
+//    into numbers of thousandths, rounded in the same way as
+//    roundFractionDigits(number, 3).  Values which are too large for
+//    integer rounding are stored as MUS_MILLI_INVALID.  Returns the
+//    number of such values.
+//
+
+int decodeRoundedParameters(int32_t* output, const unsigned char* input,
+		int count) {
+#if defined(MUSDECODE_X86)
+	if (hasAvx2()) {
+		return decodeRoundedAvx2(output, input, count);
+	} else {
+		return decodeRoundedSse2(output, input, count);
+	}
+#elif defined(MUSDECODE_WASM)
+	return decodeRoundedWasm(output, input, count);
+#else
+	return decodeRoundedScalar(output, input, count);
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// decodeRoundedScalar -- Portable version of decodeRoundedParameters().
+//
+
+static int decodeRoundedScalar(int32_t* output, const unsigned char* input,
+		int count) {
+	int invalid = 0;
+	int i;
+	for (i=0; i<count; i++) {
+		double number = loadLittleFloat(input + 4 * i);
+		if ((number > -PMX_FAST_LIMIT) && (number < PMX_FAST_LIMIT)) {
+			if (number < 0.0) {
+				output[i] = (int32_t)(number * 1000.0 - 0.5);
+			} else {
+				output[i] = (int32_t)(number * 1000.0 + 0.5);
+			}
+		} else {
+			output[i] = MUS_MILLI_INVALID;
+			invalid++;
+		}
+	}
+	return invalid;
+}
+
+
+
+//////////////////////////////
+//
+// loadLittleFloat -- Read one little-endian float.
+//
+
+static float loadLittleFloat(const unsigned char* input) {
+	union { float f; uint32_t i; } num;
+#ifdef MUSDECODE_LITTLE_ENDIAN
+	memcpy(&num.i, input, 4);
+#else
+	num.i = input[3];
+	num.i = (num.i << 8) | input[2];
+	num.i = (num.i << 8) | input[1];
+	num.i = (num.i << 8) | input[0];
+#endif
+	return num.f;
+}
+
+
+#ifdef MUSDECODE_X86
+
+//////////////////////////////
+//
+// decodeRoundedSse2 -- Four values at a time.  x86 is little-endian, so
+//    the floats are loaded directly from the input bytes.  Adding a half
+//    with the sign of the number is the same as the two cases in
+//    roundFractionDigits() (-0.0 gives 0 either way).
+//
+
+static int decodeRoundedSse2(int32_t* output, const unsigned char* input,
+		int count) {
+	const __m128  signMask  = _mm_set1_ps(-0.0f);
+	const __m128  limit     = _mm_set1_ps((float)PMX_FAST_LIMIT);
+	const __m128d signMaskD = _mm_set1_pd(-0.0);
+	const __m128d half      = _mm_set1_pd(0.5);
+	const __m128d thousand  = _mm_set1_pd(1000.0);
+	const __m128i invalidV  = _mm_set1_epi32(MUS_MILLI_INVALID);
+	int invalid = 0;
+	int i;
+	for (i=0; i+4<=count; i+=4) {
+		__m128  f     = _mm_loadu_ps((const float*)(input + 4 * i));
+		__m128  valid = _mm_cmplt_ps(_mm_andnot_ps(signMask, f), limit);
+		__m128d lo    = _mm_cvtps_pd(f);
+		__m128d hi    = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+		lo = _mm_add_pd(_mm_mul_pd(lo, thousand),
+				_mm_or_pd(_mm_and_pd(lo, signMaskD), half));
+		hi = _mm_add_pd(_mm_mul_pd(hi, thousand),
+				_mm_or_pd(_mm_and_pd(hi, signMaskD), half));
+		__m128i n = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo),
+				_mm_cvttpd_epi32(hi));
+		__m128i mask = _mm_castps_si128(valid);
+		n = _mm_or_si128(_mm_and_si128(mask, n),
+				_mm_andnot_si128(mask, invalidV));
+		_mm_storeu_si128((__m128i*)(output + i), n);
+		int bits = _mm_movemask_ps(valid);
+		if (bits != 0xf) {
+			invalid += 4 - __builtin_popcount(bits);
+		}
+	}
+	return invalid + decodeRoundedScalar(output + i, input + 4 * i, count - i);
+}
+
+
+
+//////////////////////////////
+//
+// decodeRoundedAvx2 -- Eight values at a time.
+//
+
+__attribute__((target("avx2")))
+static int decodeRoundedAvx2(int32_t* output, const unsigned char* input,
+		int count) {
+	const __m256  signMask  = _mm256_set1_ps(-0.0f);
+	const __m256  limit     = _mm256_set1_ps((float)PMX_FAST_LIMIT);
+	const __m256d signMaskD = _mm256_set1_pd(-0.0);
+	const __m256d half      = _mm256_set1_pd(0.5);
+	const __m256d thousand  = _mm256_set1_pd(1000.0);
+	const __m256i invalidV  = _mm256_set1_epi32(MUS_MILLI_INVALID);
+	int invalid = 0;
+	int i;
+	for (i=0; i+8<=count; i+=8) {
+		__m256  f     = _mm256_loadu_ps((const float*)(input + 4 * i));
+		__m256  valid = _mm256_cmp_ps(_mm256_andnot_ps(signMask, f), limit,
+				_CMP_LT_OQ);
+		__m256d lo    = _mm256_cvtps_pd(_mm256_castps256_ps128(f));
+		__m256d hi    = _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1));
+		lo = _mm256_add_pd(_mm256_mul_pd(lo, thousand),
+				_mm256_or_pd(_mm256_and_pd(lo, signMaskD), half));
+		hi = _mm256_add_pd(_mm256_mul_pd(hi, thousand),
+				_mm256_or_pd(_mm256_and_pd(hi, signMaskD), half));
+		__m256i n = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)),
+				_mm256_cvttpd_epi32(hi), 1);
+		n = _mm256_blendv_epi8(invalidV, n, _mm256_castps_si256(valid));
+		_mm256_storeu_si256((__m256i*)(output + i), n);
+		int bits = _mm256_movemask_ps(valid);
+		if (bits != 0xff) {
+			invalid += 8 - __builtin_popcount(bits);
+		}
+	}
+	return invalid + decodeRoundedSse2(output + i, input + 4 * i, count - i);
+}
+
+
+
+//////////////////////////////
+//
+// hasAvx2 -- Returns true if the processor supports AVX2 instructions.
+//
+
+static int hasAvx2(void) {
+	static int avx2 = -1;
+	if (avx2 < 0) {
+		avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return avx2;
+}
+
+#endif  /* MUSDECODE_X86 */
+
+
+#ifdef MUSDECODE_WASM
+
+//////////////////////////////
+//
+// decodeRoundedWasm -- Four values at a time with WebAssembly SIMD128,
+//    in the same way as decodeRoundedSse2().  WebAssembly is
+//    little-endian, and i32x4.trunc_sat_f64x2_zero truncates in the same
+//    way as the scalar cast for the values inside of PMX_FAST_LIMIT.
+//    There is no runtime check for SIMD support: a browser without it
+//    cannot load a module compiled with -msimd128, so the JavaScript
+//    loader chooses the build (see ../docs/mus2pmx-loader.js).
+//
+
+static int decodeRoundedWasm(int32_t* output, const unsigned char* input,
+		int count) {
+	const v128_t limit     = wasm_f32x4_splat((float)PMX_FAST_LIMIT);
+	const v128_t signMaskD = wasm_f64x2_splat(-0.0);
+	const v128_t half      = wasm_f64x2_splat(0.5);
+	const v128_t thousand  = wasm_f64x2_splat(1000.0);
+	const v128_t invalidV  = wasm_i32x4_splat(MUS_MILLI_INVALID);
+	int invalid = 0;
+	int i;
+	for (i=0; i+4<=count; i+=4) {
+		v128_t f     = wasm_v128_load(input + 4 * i);
+		v128_t valid = wasm_f32x4_lt(wasm_f32x4_abs(f), limit);
+		v128_t lo    = wasm_f64x2_promote_low_f32x4(f);
+		v128_t hi    = wasm_f64x2_promote_low_f32x4(
+				wasm_i32x4_shuffle(f, f, 2, 3, 2, 3));
+		lo = wasm_f64x2_add(wasm_f64x2_mul(lo, thousand),
+				wasm_v128_or(wasm_v128_and(lo, signMaskD), half));
+		hi = wasm_f64x2_add(wasm_f64x2_mul(hi, thousand),
+				wasm_v128_or(wasm_v128_and(hi, signMaskD), half));
+		v128_t n = wasm_i32x4_shuffle(wasm_i32x4_trunc_sat_f64x2_zero(lo),
+				wasm_i32x4_trunc_sat_f64x2_zero(hi), 0, 1, 4, 5);
+		wasm_v128_store(output + i, wasm_v128_bitselect(n, invalidV, valid));
+		int bits = wasm_i32x4_bitmask(valid);
+		if (bits != 0xf) {
+			invalid += 4 - __builtin_popcount(bits);
+		}
+	}
+	return invalid + decodeRoundedScalar(output + i, input + 4 * i, count - i);
+}
+
+#endif  /* MUSDECODE_WASM */
+
+
+
@@ -0,0 +1,31 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:00:52 PDT 2026
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026
+// Last Modified: Thu Oct 15 20:46:35 PDT 2026 added wasm SIMD128 version
+// Filename:      musdecode.h
+// Syntax:        C
+//
+// Description:   Decode blocks of little-endian floats from binary SCORE
+//                data.  SSE2 and AVX2 versions are used on x86-64, and a
+//                SIMD128 version in WebAssembly builds compiled with
+//                -msimd128, with a portable scalar version for other
+//                systems.
+//
+
+#ifndef _MUSDECODE_H_INCLUDED
+#define _MUSDECODE_H_INCLUDED
+
+#include <stdint.h>
+
+// Stored by decodeRoundedParameters() for values outside of the range
+// of PMX_FAST_LIMIT (and for NaN and infinity).  Such values have to be
+// rounded from the original float with roundFractionDigits().
+#define MUS_MILLI_INVALID INT32_MIN
+
+void     decodeLittleFloats       (float* output, const unsigned char* input,
+                                   int count);
+int      decodeRoundedParameters  (int32_t* output,
+                                   const unsigned char* input, int count);
+
+#endif  /* _MUSDECODE_H_INCLUDED */
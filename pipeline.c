@@ -0,0 +1,449 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:33:08 PDT 2026
+// Last Modified: Thu Oct 15 20:35:21 PDT 2026 parallel PMX parsing
+// Filename:      pipeline.c
+// Syntax:        C
+//
+// Description:   Convert large binary SCORE files into PMX text with
+//                several threads (see pipeline.h).  The item boundaries
+//                are found first by stepping through the item counts,
+//                which is much faster than formatting the items.  The
+//                threads of the work pool then format the chunks into
+//                separate buffers, and the writer thread passes the
+//                buffers to the PmxWriter in order.  At most
+//                PIPELINE_WINDOW chunks per thread are waiting to be
+//                written at any time, so the memory used does not depend
+//                on the size of the file.
+//
+//                PMX text is split at lines which cannot be the
+//                parameters of a text or EPS item, since these items also
+//                read the line after them (the text or the filename).
+//                Each chunk is parsed into its own builder, and the
+//                thread which finishes a chunk adds all finished chunks
+//                which are next in order to the output builder.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+#include "pmxencode.h"
+#include "workpool.h"
+
+typedef struct {
+	const unsigned char* start;
+	const unsigned char* end;
+	char*                text;
+	size_t               length;
+	size_t               capacity;
+	int                  done;
+	int                  status;
+	char                 error[SCORE_ERROR_SIZE];
+} PipelineChunk;
+
+typedef struct {
+	PmxWriter*       writer;
+	const ScoreData* score;
+	PipelineChunk*   chunks;
+	int              count;
+	int              written;   // number of chunks already written
+	int              window;    // number of chunks allowed after written
+	int              stop;      // set after an error
+	int              status;
+	pthread_mutex_t  mutex;
+	pthread_cond_t   changed;
+} Pipeline;
+
+typedef struct {
+	const char*  start;
+	const char*  end;
+	ScoreBuilder builder;
+	int          done;
+} ParseChunk;
+
+typedef struct {
+	ScoreBuilder*   builder;
+	ParseChunk*     chunks;
+	int             count;
+	int             appended;  // number of chunks added to builder
+	int             window;    // number of chunks allowed after appended
+	pthread_mutex_t mutex;
+	pthread_cond_t  changed;
+} ParseJob;
+
+// function declarations:
+static int      findChunks         (Pipeline* pipeline);
+static void     formatChunk        (void* context, int index);
+static void*    writeChunks        (void* arg);
+static int      appendChunkText    (void* context, const char* text,
+                                    size_t size);
+static int      findTextChunks     (ParseJob* job, const char* text,
+                                    size_t size);
+static void     parseChunk         (void* context, int index);
+
+
+
+//////////////////////////////
+//
+// convertScoreToPmxPipelined -- Same as convertScoreToPmx(), but the
+//    items of large data are converted with several threads.  Data
+//    smaller than PIPELINE_MIN_SIZE, or a thread count less than 2,
+//    uses convertScoreToPmx().  Returns 0 if successful, or -1 if there
+//    was an error, with the error message stored in writer->error.
+//
+
+int convertScoreToPmxPipelined(PmxWriter* writer, const unsigned char* data,
+		size_t size, int threads) {
+	if ((threads < 2) || (size < PIPELINE_MIN_SIZE)) {
+		return convertScoreToPmx(writer, data, size);
+	}
+
+	ScoreData score;
+	writer->error[0] = '\0';
+	if (openScoreData(&score, data, size) != 0) {
+		snprintf(writer->error, sizeof(writer->error), "%s", score.error);
+		return -1;
+	}
+	if (writePmxHeader(writer, &score) != 0) {
+		return -1;
+	}
+
+	Pipeline pipeline;
+	memset(&pipeline, 0, sizeof(Pipeline));
+	pipeline.writer = writer;
+	pipeline.score  = &score;
+	pipeline.window = threads * PIPELINE_WINDOW;
+	if (findChunks(&pipeline) != 0) {
+		// Not enough memory for the list of chunks:
+		return convertScoreItemsToPmx(writer, &score, score.items,
+				score.itemsEnd);
+	}
+
+	pthread_mutex_init(&pipeline.mutex, NULL);
+	pthread_cond_init(&pipeline.changed, NULL);
+	pthread_t writerThread;
+	if (pthread_create(&writerThread, NULL, writeChunks, &pipeline) != 0) {
+		pthread_cond_destroy(&pipeline.changed);
+		pthread_mutex_destroy(&pipeline.mutex);
+		free(pipeline.chunks);
+		return convertScoreItemsToPmx(writer, &score, score.items,
+				score.itemsEnd);
+	}
+	runWorkPool(threads, pipeline.count, formatChunk, &pipeline);
+	pthread_join(writerThread, NULL);
+
+	// Chunks after an error were not written:
+	int i;
+	for (i=0; i<pipeline.count; i++) {
+		free(pipeline.chunks[i].text);
+	}
+	free(pipeline.chunks);
+	pthread_cond_destroy(&pipeline.changed);
+	pthread_mutex_destroy(&pipeline.mutex);
+	return pipeline.status;
+}
+
+
+
+//////////////////////////////
+//
+// findChunks -- Split the items into chunks of about PIPELINE_CHUNK_SIZE
+//    bytes.  If an item is invalid, the last chunk contains the rest of
+//    the data, so that the error is found when the chunk is converted.
+//    Returns 0 if successful, or -1 if out of memory.
+//
+
+static int findChunks(Pipeline* pipeline) {
+	const ScoreData* score = pipeline->score;
+	size_t limit = (size_t)(score->itemsEnd - score->items) /
+			PIPELINE_CHUNK_SIZE + 2;
+	pipeline->chunks = (PipelineChunk*)calloc(limit, sizeof(PipelineChunk));
+	if (pipeline->chunks == NULL) {
+		return -1;
+	}
+
+	ScoreIterator iterator;
+	ScoreItem     item;
+	const unsigned char* start = score->items;
+	beginScoreItems(&iterator, score);
+	while (nextScoreItem(&iterator, &item) > 0) {
+		if ((size_t)(iterator.ptr - start) >= PIPELINE_CHUNK_SIZE) {
+			pipeline->chunks[pipeline->count].start = start;
+			pipeline->chunks[pipeline->count].end   = iterator.ptr;
+			pipeline->count++;
+			start = iterator.ptr;
+		}
+	}
+	if ((start < score->itemsEnd) || (pipeline->count == 0)) {
+		pipeline->chunks[pipeline->count].start = start;
+		pipeline->chunks[pipeline->count].end   = score->itemsEnd;
+		pipeline->count++;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// formatChunk -- Work function which converts the items of a chunk into
+//    PMX text stored in the chunk.  The work pool starts the chunks in
+//    order, so waiting for the writer to catch up cannot block the
+//    chunks which the writer is waiting for.
+//
+
+static void formatChunk(void* context, int index) {
+	Pipeline*      pipeline = (Pipeline*)context;
+	PipelineChunk* chunk    = &pipeline->chunks[index];
+
+	pthread_mutex_lock(&pipeline->mutex);
+	while ((index >= pipeline->written + pipeline->window) &&
+			!pipeline->stop) {
+		pthread_cond_wait(&pipeline->changed, &pipeline->mutex);
+	}
+	int skip = pipeline->stop;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	if (!skip) {
+		PmxWriter writer;
+		writer.write   = appendChunkText;
+		writer.context = chunk;
+		writer.flags   = pipeline->writer->flags;
+		// The PMX text is usually about twice the size of the binary data.
+		chunk->capacity = 2 * (size_t)(chunk->end - chunk->start) + 4096;
+		chunk->text     = (char*)malloc(chunk->capacity);
+		if (chunk->text == NULL) {
+			chunk->capacity = 0;
+		}
+		chunk->status = convertScoreItemsToPmx(&writer, pipeline->score,
+				chunk->start, chunk->end);
+		memcpy(chunk->error, writer.error, sizeof(chunk->error));
+	}
+
+	pthread_mutex_lock(&pipeline->mutex);
+	chunk->done = 1;
+	pthread_cond_broadcast(&pipeline->changed);
+	pthread_mutex_unlock(&pipeline->mutex);
+}
+
+
+
+//////////////////////////////
+//
+// writeChunks -- Writer thread: wait for each chunk in order and pass
+//    its text to the PmxWriter.  Writing stops after the first chunk
+//    with an error, after the text of the items before the error.
+//
+
+static void* writeChunks(void* arg) {
+	Pipeline*  pipeline = (Pipeline*)arg;
+	PmxWriter* writer   = pipeline->writer;
+	int i;
+	for (i=0; i<pipeline->count; i++) {
+		PipelineChunk* chunk = &pipeline->chunks[i];
+		pthread_mutex_lock(&pipeline->mutex);
+		while (!chunk->done) {
+			pthread_cond_wait(&pipeline->changed, &pipeline->mutex);
+		}
+		pthread_mutex_unlock(&pipeline->mutex);
+
+		if ((chunk->length > 0) &&
+				(writer->write(writer->context, chunk->text,
+				chunk->length) != 0)) {
+			snprintf(writer->error, sizeof(writer->error),
+					"Error: cannot write PMX data");
+			pipeline->status = -1;
+		} else if (chunk->status != 0) {
+			memcpy(writer->error, chunk->error, sizeof(writer->error));
+			pipeline->status = -1;
+		}
+		free(chunk->text);
+		chunk->text = NULL;
+
+		pthread_mutex_lock(&pipeline->mutex);
+		pipeline->written = i + 1;
+		pipeline->stop    = (pipeline->status != 0);
+		pthread_cond_broadcast(&pipeline->changed);
+		pthread_mutex_unlock(&pipeline->mutex);
+		if (pipeline->status != 0) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// appendChunkText -- Write function for a PmxWriter which stores the
+//    text in a chunk.  Returns -1 if out of memory.
+//
+
+static int appendChunkText(void* context, const char* text, size_t size) {
+	PipelineChunk* chunk = (PipelineChunk*)context;
+	if (chunk->length + size > chunk->capacity) {
+		size_t capacity = 2 * chunk->capacity + size;
+		char*  larger   = (char*)realloc(chunk->text, capacity);
+		if (larger == NULL) {
+			return -1;
+		}
+		chunk->text     = larger;
+		chunk->capacity = capacity;
+	}
+	memcpy(chunk->text + chunk->length, text, size);
+	chunk->length += size;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// convertPmxToScorePipelined -- Same as convertPmxToScore(), but large
+//    PMX text is parsed with several threads.  Text smaller than
+//    PIPELINE_MIN_SIZE, or a thread count less than 2, uses
+//    convertPmxToScore().  Returns 0 if successful, or -1 if there is
+//    not enough memory.
+//
+
+int convertPmxToScorePipelined(const char* text, size_t size,
+		ScoreBuilder* builder, int threads) {
+	if ((threads < 2) || (size < PIPELINE_MIN_SIZE)) {
+		return convertPmxToScore(text, size, builder);
+	}
+
+	ParseJob job;
+	memset(&job, 0, sizeof(ParseJob));
+	job.builder = builder;
+	job.window  = threads * PIPELINE_WINDOW;
+	if (findTextChunks(&job, text, size) != 0) {
+		// Not enough memory for the list of chunks:
+		return convertPmxToScore(text, size, builder);
+	}
+
+	pthread_mutex_init(&job.mutex, NULL);
+	pthread_cond_init(&job.changed, NULL);
+	runWorkPool(threads, job.count, parseChunk, &job);
+
+	// Chunks after an error were not added:
+	int i;
+	for (i=job.appended; i<job.count; i++) {
+		freeScoreBuilder(&job.chunks[i].builder);
+	}
+	free(job.chunks);
+	pthread_cond_destroy(&job.changed);
+	pthread_mutex_destroy(&job.mutex);
+	return builder->error ? -1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// findTextChunks -- Split PMX text into chunks of a little more than
+//    PIPELINE_CHUNK_SIZE bytes.  Each chunk ends after a complete line
+//    which does not read the next line (see readsNextLine() in
+//    pmxencode.c), so the next chunk starts with an item in the same way
+//    as when the text is parsed from the start.  Returns 0 if
+//    successful, or -1 if out of memory.
+//
+
+static int findTextChunks(ParseJob* job, const char* text, size_t size) {
+	size_t limit = size / PIPELINE_CHUNK_SIZE + 2;
+	job->chunks = (ParseChunk*)calloc(limit, sizeof(ParseChunk));
+	if (job->chunks == NULL) {
+		return -1;
+	}
+
+	PmxInput input;
+	input.ptr = text;
+	input.end = text + size;
+	const char* start = text;
+	const char* line;
+	const char* end;
+	int         reads = 0;
+	Arena       arena;
+	initArena(&arena, 256);
+	while ((size_t)(input.end - start) > PIPELINE_CHUNK_SIZE) {
+		// Look for a split after the line following the target size:
+		const char* target  = start + PIPELINE_CHUNK_SIZE;
+		const char* newline = (const char*)memchr(target, '\n',
+				input.end - target);
+		if (newline == NULL) {
+			break;
+		}
+		input.ptr = newline + 1;
+		while (input.ptr < input.end) {
+			line  = readLine(&input, &end);
+			reads = readsNextLine(line, end, &arena);
+			resetArena(&arena);
+			if (reads <= 0) {
+				break;
+			}
+		}
+		if ((reads < 0) || (input.ptr >= input.end)) {
+			break;
+		}
+		job->chunks[job->count].start = start;
+		job->chunks[job->count].end   = input.ptr;
+		job->count++;
+		start = input.ptr;
+	}
+	freeArena(&arena);
+	if (reads < 0) {
+		return -1;
+	}
+	job->chunks[job->count].start = start;
+	job->chunks[job->count].end   = input.end;
+	job->count++;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// parseChunk -- Work function which parses the PMX text of a chunk into
+//    its own builder.  The finished chunks which are next in order are
+//    then added to the output builder.  The work pool starts the chunks
+//    in order, so waiting for the earlier chunks to be added cannot
+//    block the chunks which are being waited for.
+//
+
+static void parseChunk(void* context, int index) {
+	ParseJob*   job   = (ParseJob*)context;
+	ParseChunk* chunk = &job->chunks[index];
+
+	pthread_mutex_lock(&job->mutex);
+	while ((index >= job->appended + job->window) && !job->builder->error) {
+		pthread_cond_wait(&job->changed, &job->mutex);
+	}
+	int skip = job->builder->error;
+	pthread_mutex_unlock(&job->mutex);
+
+	if (!skip) {
+		// The binary data is usually about half of the size of the PMX text.
+		initScoreBuilder(&chunk->builder, (chunk->end - chunk->start) / 2 + 1024);
+		convertPmxToScore(chunk->start, chunk->end - chunk->start,
+				&chunk->builder);
+	}
+
+	pthread_mutex_lock(&job->mutex);
+	chunk->done = 1;
+	while ((job->appended < job->count) &&
+			job->chunks[job->appended].done && !job->builder->error) {
+		ParseChunk* next = &job->chunks[job->appended];
+		appendScoreItems(job->builder, &next->builder);
+		freeScoreBuilder(&next->builder);
+		job->appended++;
+	}
+	pthread_cond_broadcast(&job->changed);
+	pthread_mutex_unlock(&job->mutex);
+}
+
+
+
@@ -0,0 +1,46 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:33:08 PDT 2026
+// Last Modified: Thu Oct 15 20:35:21 PDT 2026 parallel PMX parsing
+// Filename:      pipeline.h
+// Syntax:        C
+//
+// Description:   Convert large binary SCORE files into PMX text with
+//                several threads.  The items are split into chunks which
+//                are formatted in parallel, and the text of the chunks is
+//                written in order by a separate thread, giving the same
+//                output as convertScoreToPmx().
+//
+//                Large PMX text is converted into binary SCORE items in
+//                the same way: the text is split into chunks at lines
+//                where an item starts, and each chunk is parsed into
+//                a separate builder.  The builders are added to the
+//                output in order, giving the same data as
+//                convertPmxToScore().
+//
+
+#ifndef _PIPELINE_H_INCLUDED
+#define _PIPELINE_H_INCLUDED
+
+#include <stddef.h>
+
+#include "libscore.h"
+
+// Smaller data is converted with convertScoreToPmx():
+#define PIPELINE_MIN_SIZE (1 << 20)
+
+// Size of the binary data or PMX text of a chunk (which ends at the end
+// of an item):
+#define PIPELINE_CHUNK_SIZE (1 << 18)
+
+// Number of chunks per thread which can be converted before they are
+// written or added to the output:
+#define PIPELINE_WINDOW 4
+
+int      convertScoreToPmxPipelined  (PmxWriter* writer,
+                                      const unsigned char* data,
+                                      size_t size, int threads);
+int      convertPmxToScorePipelined  (const char* text, size_t size,
+                                      ScoreBuilder* builder, int threads);
+
+#endif  /* _PIPELINE_H_INCLUDED */
@@ -2,17 +2,69 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Feb 20 14:45:23 PST 2013
 // Last Modified: Fri Feb 22 02:11:42 PST 2013 added EPS graphic items
+// Last Modified: Thu Oct 15 20:04:30 PDT 2026 single-pass input parsing
+// Last Modified: Thu Oct 15 20:06:04 PDT 2026 buffered output
+// Last Modified: Thu Oct 15 20:06:43 PDT 2026 4-byte count for large files
+// Last Modified: Thu Oct 15 20:08:34 PDT 2026 no limit on parameter count
+// Last Modified: Thu Oct 15 20:09:59 PDT 2026 split multi-page input
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026 moved encoder to pmxencode.c
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026 conversion moved to libscore
+// Last Modified: Thu Oct 15 20:27:09 PDT 2026 added --stats option
+// Last Modified: Thu Oct 15 20:29:08 PDT 2026 added --trace timeline
+// Last Modified: Thu Oct 15 20:35:21 PDT 2026 parse large files in parallel
+// Last Modified: Thu Oct 15 20:38:08 PDT 2026 added --cache option
 // Filename:      pmx2mus.c
 // Syntax:        C
 //
 // Description:   Convert SCORE PMX data into binary SCORE files.
 //
-// Limitations:   Cannot handle very large WinScore files (which uses 
-//				    a 4-byte count at the start of the file).
+//                With the --split or --outdir option, the input may
+//                contain multiple pages separated by ##PAGEBREAK lines
+//                (as written by mus2pmx for multiple input files).  Each
+//                page is converted into a separate binary file, named
+//                after the ##FILE: line of the page when there is one
+//                (without its directory), or otherwise out-001.mus,
+//                out-002.mus, and so on.  The pages are converted in
+//                parallel.  With the --cache option, only the pages whose
+//                text has changed since the last run with the same
+//                manifest file are converted (see cache.h).
 //
-// Usage:         pmx2mus file.pmx file.mus
+//                A large input converted into a single output file is
+//                split into chunks at item boundaries, which are parsed
+//                in parallel with the number of threads given by -j (see
+//                pipeline.h).  The output is the same as when the input
+//                is parsed by one thread.
 //
-// $Smake:        gcc -O3 -o pmx2mus pmx2mus.c
+//                The --stats option writes statistics of the conversion
+//                to standard error (or as JSON to the file given with
+//                --stats-json): bytes read and written, the number of
+//                items of each P1 type, the time spent in each phase and
+//                the slowest pages.  "decode" is the parsing of the PMX
+//                text into binary items, and "format" is the addition of
+//                the count and trailer.
+//
+//                The --trace option writes a timeline of the conversion
+//                in the Trace Event JSON format (see trace.h), with a span
+//                for each output file on the thread which converted it,
+//                containing spans for parsing the PMX text, adding the
+//                count and trailer, and writing the file.
+//
+// Large files:   Files with more than 65535 4-byte words after the count
+//                are written as large WinScore files, which use a 4-byte
+//                count at the start of the file.  The size of such files
+//                is a multiple of 4, while other files have a 2-byte count
+//                and a size of 2 more than a multiple of 4.  This is how
+//                mus2pmx identifies the size of the count.
+//
+// Usage:         pmx2mus [-j threads] file.pmx file.mus
+//                pmx2mus file.pmx - > file.mus
+//                pmx2mus --outdir dir [-j threads] movement.pmx
+//                pmx2mus --split [-j threads] movement.pmx
+//                pmx2mus --cache manifest --outdir dir movement.pmx
+//                pmx2mus --stats|--stats-json stats.json [--slowest n] ...
+//                pmx2mus --trace trace.json ...
+//
+// $Smake:        gcc -O3 -o pmx2mus pmx2mus.c workpool.c runstats.c trace.c pipeline.c cache.c libscore.a -lm -lpthread
 //
 
 #include <string.h>
@@ -20,29 +72,136 @@
 #include <stdlib.h>
 #include <math.h>
 #include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "libscore.h"
+#include "pmxencode.h"
+#include "workpool.h"
+#include "runstats.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "cache.h"
+
+#ifdef _WIN32
+	#include <io.h>
+	#include <fcntl.h>
+	#include <direct.h>
+	#define mkdir(path, mode) _mkdir(path)
+#endif
+
+// One page of a multi-page PMX file:
+typedef struct {
+	const char* start;
+	const char* end;
+	char*       filename;
+} PmxPage;
+
+// Shared settings for the threads converting the pages:
+typedef struct {
+	PmxPage*         pages;
+	ConversionCache* cache;     // NULL if --cache is not given
+	int              failures;
+	pthread_mutex_t  mutex;
+} PageJob;
 
 // function declarations:
-void     printAsciiFileAsBinary  (const char* inputfile, 
+int      printAsciiFileAsBinary  (const char* inputfile, 
                                   const char* outputfile);
-int      processInputLine        (FILE* input, FILE* output);
-int      readAsciiNumberLine     (float* param, int index, 
-                                  const char* string);
-char*    removeNewline           (char* buffer);
-void     writeLittleShort        (FILE* output, int value);
-void     writeLittleFloat        (FILE* output, float value);
-void     writeLittleInt          (FILE* output, int value);
+int      convertPages            (const char* inputfile, const char* outdir,
+                                  int threads, const char* cacheFile);
+void     convertPage             (void* context, int index);
+int      convertPmxData          (const char* data, size_t size,
+                                  const char* filename);
+int      convertPmxDataWithStats (const char* data, size_t size,
+                                  const char* filename);
+int      findPages               (const char* data, size_t size,
+                                  PmxPage** pages);
+char*    makePageFilename        (const PmxPage* page, const char* outdir,
+                                  int number);
+void     usage                   (const char* command);
+int      writeOutputFile         (const unsigned char* data, size_t size,
+                                  const char* filename);
+
+RunStats* runStats    = NULL;  // statistics for the --stats option
+int       parseThreads = 1;     // threads for parsing a large input
 
 ///////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
-	if (argc != 3) {
-		printf("Usage: %s input.pmx output.mus\n", argv[0]);
+	static struct option options[] = {
+		{ "outdir",     required_argument, NULL, 'o' },
+		{ "split",      no_argument,       NULL, 's' },
+		{ "jobs",       required_argument, NULL, 'j' },
+		{ "stats",      no_argument,       NULL, 'S' },
+		{ "stats-json", required_argument, NULL, 'J' },
+		{ "slowest",    required_argument, NULL, 'N' },
+		{ "trace",      required_argument, NULL, 'T' },
+		{ "cache",      required_argument, NULL, 'C' },
+		{ "help",       no_argument,       NULL, 'h' },
+		{ NULL,         0,                 NULL, 0   }
+	};
+	const char* outdir    = NULL;
+	const char* statsFile = NULL;
+	const char* traceFile = NULL;
+	const char* cacheFile = NULL;
+	int         splitQ    = 0;
+	int         statsQ    = 0;
+	int         slowest   = STATS_SLOWEST;
+	int         threads   = getProcessorCount();
+	int         opt;
+	while ((opt = getopt_long(argc, argv, "o:sj:h", options, NULL)) != -1) {
+		switch (opt) {
+			case 'o': outdir = optarg; splitQ = 1; break;
+			case 's': splitQ = 1;                  break;
+			case 'j': threads = atoi(optarg);      break;
+			case 'S': statsQ = 1;                  break;
+			case 'J': statsFile = optarg;          break;
+			case 'N': slowest = atoi(optarg);      break;
+			case 'T': traceFile = optarg;          break;
+			case 'C': cacheFile = optarg;          break;
+			default:  usage(argv[0]);              exit(1);
+		}
+	}
+	int fileCount = argc - optind;
+	char** files  = argv + optind;
+
+	if ((fileCount != (splitQ ? 1 : 2)) || (cacheFile && !splitQ)) {
+		usage(argv[0]);
 		exit(1);
 	}
 
-	printAsciiFileAsBinary(argv[1], argv[2]);
+	RunStats stats;
+	if (statsQ || (statsFile != NULL)) {
+		initRunStats(&stats, "pmx2mus", slowest);
+		runStats = &stats;
+	}
+	if (traceFile != NULL) {
+		startTrace("pmx2mus");
+	}
 
-	return 0;
+	int status;
+	if (splitQ) {
+		status = convertPages(files[0], outdir ? outdir : ".", threads,
+				cacheFile) ? 1 : 0;
+	} else {
+		parseThreads = threads;
+		status = printAsciiFileAsBinary(files[0], files[1]) ? 1 : 0;
+	}
+
+	if (runStats != NULL) {
+		fflush(stdout);
+		if (writeRunStats(runStats, statsFile) != 0) {
+			status = 1;
+		}
+		freeRunStats(runStats);
+	}
+	if ((traceFile != NULL) && (writeTrace(traceFile) != 0)) {
+		status = 1;
+	}
+	return status;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -51,276 +210,411 @@ int main(int argc, char** argv) {
 //////////////////////////////
 //
 // printAsciiFileAsBinary -- convert PMX data from a text file into a binary
-//    SCORE .mus file.  Currently input will be converted to a single output.
-//    In the future, the fuction may be expanded so allow multiple page 
-//    input and then save to enumerated output filenames.
+//    SCORE .mus file.  All of the input is converted to a single output
+//    (see convertPages() for splitting multiple-page input).  The output
+//    filename "-" writes the binary data to standard output.  Returns 0
+//    if successful.
 //
 
-void printAsciiFileAsBinary(const char* inputfile, const char* outputfile) {
-	FILE *input = fopen(inputfile, "r");
-	if (input == NULL) {
-		printf("Error: cannot open file %s for reading.\n", inputfile);
-	}
-
-	FILE *output = fopen(outputfile, "w");
-	if (output == NULL) {
-		printf("Error: cannot open file %s for writing.\n", outputfile);
+int printAsciiFileAsBinary(const char* inputfile, const char* outputfile) {
+	double time = (runStats || isTracing()) ? getStatsTime() : 0.0;
+	size_t filesize = 0;
+	const char* data = (const char*)mapInputFile(inputfile, &filesize);
+	if (data == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for reading.\n", inputfile);
+		exit(1);
 	}
-
-	// store a place holder for the number of parameters stored in the file.
-	writeLittleShort(output, 0);
-
-	int count = 0;  // number of 4-byte words stored in file (excluding initial
-					    // short in word counter.
-	while (!feof(input)) {
-		count += processInputLine(input, output);
+	if (runStats != NULL) {
+		runStats->seconds[STATS_READ] += getStatsTime() - time;
 	}
-	fclose(input);
-
-	// write the trailer
-	writeLittleFloat(output, 0.0);     // start of trailer marker (size of 
-	                                   //  trailer is second-to-last # in file)
-	writeLittleInt(output, 4000000);   // serial number
-	writeLittleFloat(output, 4.0);     // program version
-	writeLittleFloat(output, 0.0);     // measurement code 0.0=in; 1.0=cm
-	writeLittleFloat(output, 5.0);     // previous numbers in trailer (inclusive)
-	writeLittleFloat(output, -9999.0); // end of trailer marker
-	count += 6;
-
-	// return to the start of the output file and store the real item count
-	rewind(output);
-	writeLittleShort(output, count);
-	fclose(output);
+	addTraceSpan("read", inputfile, time, getTraceTime());
+	int status = convertPmxData(data, filesize, outputfile);
+	unmapInputFile((const unsigned char*)data, filesize);
+	return status;
 }
 
 
 
 //////////////////////////////
 //
-// processInputLine -- Extract and write one SCORE item from input.
+// convertPages -- Convert each page of a multiple-page PMX file into
+//    a separate binary file in outdir.  The pages are independent, so
+//    they are converted in parallel.  If cacheFile is not NULL, pages
+//    with up-to-date output are skipped (see cache.h).  Returns the number
+//    of pages which could not be written (plus one if the cache manifest
+//    could not be written).
 //
 
-int processInputLine(FILE* input, FILE* output) {
-	int    count        =  0;
-	int    wcount       =  0;
-	int    pcount       =  0;
-	char   buffer[1024] = {0};
-	float  param[100]   = {0};
-	int    textcount    =  0;
-	int    extrapad     =  0;
-	int    textblocks   =  0;
-	float  number       =  0.0;
-	int    i;
-
-	if (feof(input)) {
-		// end of file, so return current count (which should be 0):
-		return count;
+int convertPages(const char* inputfile, const char* outdir, int threads,
+		const char* cacheFile) {
+	size_t filesize = 0;
+	double time = (runStats || isTracing()) ? getStatsTime() : 0.0;
+	const char* data = (const char*)mapInputFile(inputfile, &filesize);
+	if (data == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for reading.\n", inputfile);
+		exit(1);
 	}
+	if (runStats != NULL) {
+		// The input is shared by all pages, so the time is not added
+		// to any of them.
+		runStats->seconds[STATS_READ] += getStatsTime() - time;
+	}
+	addTraceSpan("read", inputfile, time, getTraceTime());
 
-	char* ptr = fgets(buffer, sizeof(buffer), input);
-	if (strlen(buffer) > 1000) {
-		printf("Error: text line is too long: %s\n", buffer);
+	PmxPage* pages = NULL;
+	int pageCount = findPages(data, filesize, &pages);
+	int i, j;
+	for (i=0; i<pageCount; i++) {
+		pages[i].filename = makePageFilename(&pages[i], outdir, i + 1);
+	}
+	// Do not let one page overwrite another one:
+	for (i=0; i<pageCount; i++) {
+		for (j=0; j<i; j++) {
+			if (strcmp(pages[i].filename, pages[j].filename) == 0) {
+				fprintf(stderr,
+						"Error: pages %d and %d are both written to %s\n",
+						j + 1, i + 1, pages[i].filename);
+				exit(1);
+			}
+		}
+	}
+	if ((mkdir(outdir, 0777) != 0) && (errno != EEXIST)) {
+		fprintf(stderr, "Error: cannot create directory %s\n", outdir);
 		exit(1);
-	} else if (strcmp(buffer, "") == 0) {
-		// empty line
-		return count;
 	}
 
-	if (isdigit(buffer[0])) {
-		pcount = readAsciiNumberLine(param, 0, buffer);
-	} else if ((tolower(buffer[0]) == 't') && isspace(buffer[1])) {
-		param[0] = 16.0;
-		pcount = readAsciiNumberLine(param, 1, &(buffer[2]));
-		// read the text line for the text item
-		buffer[0] = '\0';
-		ptr = fgets(buffer, sizeof(buffer), input);
-		if (strlen(buffer) > 1000) {
-			printf("Error: text line is too long: %s\n", buffer);
-			exit(1);
-		}
-		removeNewline(buffer);
-		textcount = strlen(buffer);
-		extrapad  = textcount % 4;
-		if (extrapad > 0) {
-			extrapad = 4 - extrapad;
-		}
-		// store spaces in dummy charater spots to fill out a block of four
-		// bytes at the end of the text item string.
-		for (i=0; i<extrapad; i++) {
-			buffer[textcount+i] = (char)0x20;
-		}
-		textblocks = (textcount + extrapad  ) / 4;
-		// P12 of a text object must match the number of characters
-		// in the text string.  In other words "textcount" should match
-		// param[11].  So to enforce this requirement, just store textcount
-		// in param[11].
-		param[11] = textcount;
-		if (pcount < 13) {
-			// Also need to include P13 which is the width of the text.
-			// Set to zero if it does not exist in PMX data.
-			pcount = 13;
-		}
-	} else {
-		// Not a list of numbers. Something else, so just ignore line
-		return count;
+	ConversionCache cache;
+	if ((cacheFile != NULL) && (openConversionCache(&cache, cacheFile,
+			"pmx2mus " SCORE_LIBRARY_VERSION, pageCount) != 0)) {
+		fprintf(stderr, "Error: out of memory for cache %s\n", cacheFile);
+		exit(1);
 	}
 
-	// Write the parameters to the output file.
-	if ((int)param[0] == 15) {
-		// write an EPS graphic file item
-		if (pcount != 13) {
-			// must have 13 numeric parameters before filename
-			pcount = 13;
-		}
-		// read the next line in the file which contains the filename
-		// the filename may have trailing spaces on its line and may
-		// be padded with spaces to make the length of the filename
-		// be a multiple of 4.
-		ptr = fgets(buffer, sizeof(buffer), input);
-		if (strlen(buffer) > 1000) {
-			printf("Error: text line is too long: %s\n", buffer);
-			exit(1);
-		}
-		removeNewline(buffer);
-		textcount = strlen(buffer);
-		extrapad  = textcount % 4;
-		if (extrapad > 0) {
-			extrapad = 4 - extrapad;
-		}
-		// store spaces in dummy charater spots to fill out a block of four
-		// bytes at the end of the EPS filename item string.
-		for (i=0; i<extrapad; i++) {
-			buffer[textcount+i] = (char)0x20;
-		}
-		textblocks = (textcount + extrapad  ) / 4;
-		number = pcount + textblocks;
-		writeLittleFloat(output, number);
-		count++;
-		for (i=0; i<pcount; i++) {
-			writeLittleFloat(output, param[i]);
-			count++;
+	PageJob job;
+	job.pages    = pages;
+	job.cache    = cacheFile ? &cache : NULL;
+	job.failures = 0;
+	pthread_mutex_init(&job.mutex, NULL);
+	runWorkPool(threads, pageCount, convertPage, &job);
+	pthread_mutex_destroy(&job.mutex);
+
+	int status = job.failures;
+	if (cacheFile != NULL) {
+		if (saveConversionCache(&cache) != 0) {
+			status++;
 		}
+		fprintf(stderr, "pmx2mus: cache: %d hits, %d misses, %d evicted\n",
+				cache.hits, cache.misses, cache.evicted);
+		freeConversionCache(&cache);
+	}
 
-		wcount = fwrite(buffer, sizeof(char), textcount + extrapad, output);
-		count += textblocks;
-	} else if ((int)param[0] == 16) {
-		// write a text item
-		number = pcount + textblocks;
-		writeLittleFloat(output, number);
-		count++;
-		for (i=0; i<pcount; i++) {
-			writeLittleFloat(output, param[i]);
-			count++;
-		}
+	for (i=0; i<pageCount; i++) {
+		free(pages[i].filename);
+	}
+	free(pages);
+	unmapInputFile((const unsigned char*)data, filesize);
+	return status;
+}
 
-		wcount = fwrite(buffer, sizeof(char), textcount + extrapad, output);
-		count += textblocks;
-	} else {
-		number = pcount;
-		writeLittleFloat(output, number);
-		count++;
-		for (i=0; i<pcount; i++) {
-			writeLittleFloat(output, param[i]);
-			count++;
+
+
+//////////////////////////////
+//
+// convertPage -- Work function for convertPages(): convert one page
+//    (unless the cache has an up-to-date output file for it).
+//
+
+void convertPage(void* context, int index) {
+	PageJob* job  = (PageJob*)context;
+	PmxPage* page = &job->pages[index];
+	size_t   size = page->end - page->start;
+	uint64_t hash = 0;
+	if (job->cache != NULL) {
+		hash = hashCacheData(page->start, size);
+		if (checkCacheEntry(job->cache, index, page->filename, hash)) {
+			return;
 		}
 	}
+	if (convertPmxData(page->start, size, page->filename) != 0) {
+		pthread_mutex_lock(&job->mutex);
+		job->failures++;
+		pthread_mutex_unlock(&job->mutex);
+	} else if (job->cache != NULL) {
+		storeCacheEntry(job->cache, index, page->filename, hash);
+	}
+}
 
-	return count;
+
+
+//////////////////////////////
+//
+// convertPmxData -- Convert PMX data into binary SCORE data and write it
+//    to a file.  Returns 0 if successful.
+//
+
+int convertPmxData(const char* data, size_t size, const char* filename) {
+	if ((runStats != NULL) || isTracing()) {
+		return convertPmxDataWithStats(data, size, filename);
+	}
+	ScoreBuilder builder;
+	const unsigned char* output;
+	size_t outputSize;
+	// The binary data is usually about half of the size of the PMX text.
+	initScoreBuilder(&builder, size / 2 + 1024);
+	if ((convertPmxToScorePipelined(data, size, &builder,
+			parseThreads) != 0) ||
+			(finishScoreData(&builder, &output, &outputSize) != 0)) {
+		fprintf(stderr, "Error: out of memory for %s\n", filename);
+		freeScoreBuilder(&builder);
+		return -1;
+	}
+	int status = writeOutputFile(output, outputSize, filename);
+	freeScoreBuilder(&builder);
+	return status;
 }
 
 
 
 //////////////////////////////
 //
-// removeNewline -- Get rid of any 0x0a or 0x0d characters that may
-//    be hanging around at the end of the line.
+// convertPmxDataWithStats -- Same as convertPmxData(), but also collect
+//    the statistics of the output file for --stats and its spans for
+//    --trace.
 //
 
-char* removeNewline(char* buffer) {
-	int len = strlen(buffer);
-	int i;
-	for (i=len-1; i>=0; i--) {
-		if ((buffer[i] == 0x0a) || (buffer[i] == 0x0d)) {
-			buffer[i] = '\0';
-		} else {
-			return buffer;
+int convertPmxDataWithStats(const char* data, size_t size,
+		const char* filename) {
+	ScoreBuilder builder;
+	FileStats    stats;
+	const unsigned char* output;
+	size_t outputSize;
+	int status = -1;
+	beginFileStats(&stats, filename);
+	stats.bytesRead = size;
+
+	double start = getStatsTime();
+	double time  = start;
+	double end;
+	initScoreBuilder(&builder, size / 2 + 1024);
+	if (convertPmxToScorePipelined(data, size, &builder, parseThreads) == 0) {
+		end = addPhaseTime(&stats, STATS_DECODE, time);
+		addTraceSpan("parse", NULL, time, end);
+		time = end;
+		if (finishScoreData(&builder, &output, &outputSize) == 0) {
+			end = addPhaseTime(&stats, STATS_FORMAT, time);
+			addTraceSpan("finish", NULL, time, end);
+			time = end;
+			status = writeOutputFile(output, outputSize, filename);
+			end = addPhaseTime(&stats, STATS_WRITE, time);
+			addTraceSpan("write", NULL, time, end);
+			time = end;
+			stats.bytesWritten = (status == 0) ? outputSize : 0;
+			if (runStats != NULL) {
+				countScoreItems(&stats, output, outputSize);
+			}
 		}
 	}
-	return buffer;
+	if (builder.error) {
+		fprintf(stderr, "Error: out of memory for %s\n", filename);
+	}
+	freeScoreBuilder(&builder);
+	addTraceSpan("file", filename, start, time);
+
+	if (runStats != NULL) {
+		stats.failed = (status != 0);
+		addFileStats(runStats, &stats);
+	}
+	return status;
 }
 
 
 
 //////////////////////////////
 //
-// readAsciiNumberLine -- Read a list of numbers on a line of text.
-//      Should check for unexpected text on line after first number.
+// findPages -- Split PMX data into pages at lines starting with
+//    ##PAGEBREAK.  An empty page after a final ##PAGEBREAK is ignored.
+//    Returns the number of pages, which are stored in a new array.
 //
 
-int readAsciiNumberLine(float* param, int index, const char* string) {
-	char buffer[1024] = {0};
-	strcpy(buffer, string);
-	char* ptr = strtok(buffer, "\n\t ");
-	double number = 0.0;
-	int counter = index;
-
-	while (ptr != NULL) {
-		number = strtod(ptr, NULL);
-		if (counter > 100) {
-			printf("Error: item parameter count is too large\n");
-			exit(1);
+int findPages(const char* data, size_t size, PmxPage** pages) {
+	PmxInput input;
+	input.ptr = data;
+	input.end = data + size;
+	int count    = 0;
+	int capacity = 16;
+	*pages = (PmxPage*)malloc(capacity * sizeof(PmxPage));
+	if (*pages == NULL) {
+		fprintf(stderr, "Error: out of memory for page list\n");
+		exit(1);
+	}
+	const char* start = data;
+	const char* line;
+	const char* end;
+	while (1) {
+		line = readLine(&input, &end);
+		int pagebreak = (end - line >= 11) &&
+				(strncmp(line, "##PAGEBREAK", 11) == 0);
+		if (!pagebreak && (input.ptr < input.end)) {
+			continue;
 		}
-		param[counter++] = number;
-		ptr = strtok(NULL, "\n\t ");
+		const char* stop = pagebreak ? line : input.end;
+		if (!pagebreak && (count > 0)) {
+			// Ignore the last page if it is empty.
+			const char* ptr = start;
+			while ((ptr < stop) && isspace((unsigned char)*ptr)) {
+				ptr++;
+			}
+			if (ptr == stop) {
+				break;
+			}
+		}
+		if (count == capacity) {
+			capacity *= 2;
+			PmxPage* larger = (PmxPage*)realloc(*pages, capacity * sizeof(PmxPage));
+			if (larger == NULL) {
+				fprintf(stderr, "Error: out of memory for page list\n");
+				exit(1);
+			}
+			*pages = larger;
+		}
+		(*pages)[count].start    = start;
+		(*pages)[count].end      = stop;
+		(*pages)[count].filename = NULL;
+		count++;
+		if (!pagebreak) {
+			break;
+		}
+		start = input.ptr;
 	}
-
-	return counter;
+	return count;
 }
 
 
 
 //////////////////////////////
 //
-// writeLittleShort -- Write a two-byte integer to a file with smallest
-//   byte written first.
+// makePageFilename -- Return the output filename for a page: the
+//    filename from the ##FILE: line of the page (without its directory)
+//    or else out-001.mus for page 1, and so on.  The returned string
+//    is allocated with malloc().
 //
 
-void writeLittleShort(FILE* output, int value) {
-	char bytes[2];
-	bytes[0] = (char)(value & 0xff);
-	bytes[1] = (char)((value >> 8) & 0xff);
-	int count = fwrite(bytes, sizeof(char), 2, output);
+char* makePageFilename(const PmxPage* page, const char* outdir, int number) {
+	PmxInput input;
+	input.ptr = page->start;
+	input.end = page->end;
+	const char* name    = NULL;
+	const char* nameEnd = NULL;
+	const char* line;
+	const char* end;
+	while (input.ptr < input.end) {
+		line = readLine(&input, &end);
+		if ((end - line < 7) || (strncmp(line, "##FILE:", 7) != 0)) {
+			continue;
+		}
+		name = line + 7;
+		while ((name < end) && ((*name == ' ') || (*name == '\t'))) {
+			name++;
+		}
+		nameEnd = end;
+		while ((nameEnd > name) && isspace((unsigned char)nameEnd[-1])) {
+			nameEnd--;
+		}
+		const char* ptr;
+		for (ptr=name; ptr<nameEnd; ptr++) {
+			if ((*ptr == '/') || (*ptr == '\\')) {
+				name = ptr + 1;
+			}
+		}
+		break;
+	}
+
+	size_t length = strlen(outdir) + 32 + (name ? nameEnd - name : 0);
+	char* filename = (char*)malloc(length);
+	if (filename == NULL) {
+		fprintf(stderr, "Error: out of memory for filename\n");
+		exit(1);
+	}
+	if ((name != NULL) && (nameEnd > name)) {
+		snprintf(filename, length, "%s/%.*s", outdir, (int)(nameEnd - name),
+				name);
+	} else {
+		snprintf(filename, length, "%s/out-%03d.mus", outdir, number);
+	}
+	return filename;
 }
 
 
 
 //////////////////////////////
 //
-// writeLittleFloat -- Write a four-byte float to a file with smallest
-//   byte written first.
+// usage -- Print the command-line options.
 //
 
-void writeLittleFloat(FILE* output, float value) {
-	union {int i; float f; } data;
-	data.f = value;
-	writeLittleInt(output, data.i);
+void usage(const char* command) {
+	fprintf(stderr, "Usage: %s [-j threads] input.pmx output.mus\n", command);
+	fprintf(stderr, "       %s --outdir dir [-j threads] [--cache file] "
+			"input.pmx\n", command);
+	fprintf(stderr, "       %s --split [-j threads] [--cache file] "
+			"input.pmx\n", command);
+	fprintf(stderr, "Use - as the output filename to write to standard "
+			"output.\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "   -o, --outdir dir  write each page of the input "
+			"into dir\n");
+	fprintf(stderr, "   -s, --split       write each page into the "
+			"current directory\n");
+	fprintf(stderr, "   -j, --jobs n      number of threads for "
+			"converting pages or\n");
+	fprintf(stderr, "                     a large input file\n");
+	fprintf(stderr, "                     (default: number of processor "
+			"cores)\n");
+	fprintf(stderr, "   --stats           write statistics of the "
+			"conversion to stderr\n");
+	fprintf(stderr, "   --stats-json file write the statistics to file "
+			"as JSON\n");
+	fprintf(stderr, "   --slowest n       number of slowest pages in the "
+			"statistics\n");
+	fprintf(stderr, "                     (default: %d)\n", STATS_SLOWEST);
+	fprintf(stderr, "   --trace file      write a timeline of the "
+			"conversion to file\n");
+	fprintf(stderr, "   --cache file      only convert changed pages "
+			"with --outdir or\n");
+	fprintf(stderr, "                     --split, with a manifest of the "
+			"outputs in file\n");
 }
 
 
 
 //////////////////////////////
 //
-// writeLittleInt -- Write a four-byte int to a file with smallest
-//   byte written first.
+// writeOutputFile -- Write the binary data to a file (or to standard
+//    output if the filename is "-").  Returns 0 if successful.
 //
 
-void writeLittleInt(FILE* output, int value) {
-	char bytes[4];
-	bytes[0] = (char)(value & 0xff);
-	bytes[1] = (char)((value >> 8)  & 0xff);
-	bytes[2] = (char)((value >> 16) & 0xff);
-	bytes[3] = (char)((value >> 24) & 0xff);
-	int count = fwrite(bytes, sizeof(char), 4, output);
+int writeOutputFile(const unsigned char* data, size_t size,
+		const char* filename) {
+	FILE* file = stdout;
+	if (strcmp(filename, "-") != 0) {
+		file = fopen(filename, "wb");
+		if (file == NULL) {
+			fprintf(stderr, "Error: cannot open file %s for writing.\n",
+					filename);
+			return -1;
+		}
+	} else {
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	}
+	size_t written = fwrite(data, 1, size, file);
+	int status = (file == stdout) ? fflush(file) : fclose(file);
+	if ((written != size) || (status != 0)) {
+		fprintf(stderr, "Error: cannot write to file %s.\n", filename);
+		return -1;
+	}
+	return 0;
 }
 
 
+
@@ -0,0 +1,330 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Wed Feb 20 14:45:23 PST 2013
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026 moved from pmx2mus.c
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026 store items with ScoreBuilder
+// Last Modified: Thu Oct 15 20:24:20 PDT 2026 export readAsciiNumberLine()
+// Filename:      pmxencode.c
+// Syntax:        C
+//
+// Description:   Convert SCORE PMX text in memory into binary SCORE
+//                items (convertPmxToScore() in libscore.h), and read the
+//                lines of PMX text.
+//
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "libscore.h"
+#include "pmxencode.h"
+#include "arena.h"
+
+// function declarations:
+static int      processInputLine     (PmxInput* input, ScoreBuilder* builder,
+                                      Arena* arena);
+static int      parsePmxNumber       (double* value, const char** ptr,
+                                      const char* end, Arena* arena);
+static const char* removeNewline     (const char* line, const char* end);
+
+
+
+//////////////////////////////
+//
+// convertPmxToScore -- Convert PMX text into SCORE items which are added
+//    to the builder.  The caller adds the trailer with finishScoreData().
+//    Returns 0 if successful, or -1 if there is not enough memory.
+//
+
+int convertPmxToScore(const char* text, size_t size, ScoreBuilder* builder) {
+	PmxInput input;
+	input.ptr = text;
+	input.end = text + size;
+
+	// Storage for the parameters of the current item:
+	Arena arena;
+	initArena(&arena, 4096);
+
+	while ((input.ptr < input.end) && !builder->error) {
+		processInputLine(&input, builder, &arena);
+		resetArena(&arena);
+	}
+	freeArena(&arena);
+	return builder->error ? -1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// processInputLine -- Extract one SCORE item from input and add it to
+//    the builder.  The parameters are stored in the arena, which the
+//    caller resets after each item.  Returns -1 and sets builder->error
+//    if there is not enough memory.
+//
+
+static int processInputLine(PmxInput* input, ScoreBuilder* builder,
+		Arena* arena) {
+	int    pcount       =  0;
+	float* param        =  NULL;
+	int    textcount    =  0;
+	const char* text    = "";
+	const char* line;
+	const char* end;
+
+	line = readLine(input, &end);
+	if (line == end) {
+		// empty line
+		return 0;
+	}
+
+	// Each number on the line takes at least two characters (including
+	// the separator).  Text and EPS items have at least 13 parameters,
+	// and unused ones are zero.
+	size_t paramSize = (size_t)(end - line) / 2 + 14;
+	param = (float*)allocateArena(arena, paramSize * sizeof(float));
+	if (param == NULL) {
+		builder->error = 1;
+		return -1;
+	}
+	memset(param, 0, 13 * sizeof(float));
+
+	// A "t" on a line by itself still starts a text item.
+	int separator = (end - line > 1) ? isspace((unsigned char)line[1]) :
+			((end < input->end) && (*end == '\n'));
+	if (isdigit((unsigned char)line[0])) {
+		pcount = readAsciiNumberLine(param, 0, line, end, arena);
+	} else if ((tolower((unsigned char)line[0]) == 't') && separator) {
+		param[0] = 16.0;
+		pcount = readAsciiNumberLine(param, 1, line + 2, end, arena);
+		// read the text line for the text item
+		text = readLine(input, &end);
+		end  = removeNewline(text, end);
+		textcount = (int)(end - text);
+		// P12 of a text object must match the number of characters
+		// in the text string.  In other words "textcount" should match
+		// param[11].  So to enforce this requirement, just store textcount
+		// in param[11].
+		param[11] = textcount;
+		if (pcount < 13) {
+			// Also need to include P13 which is the width of the text.
+			// Set to zero if it does not exist in PMX data.
+			pcount = 13;
+		}
+	} else {
+		// Not a list of numbers. Something else, so just ignore line
+		return 0;
+	}
+
+	if (pcount < 0) {
+		builder->error = 1;
+		return -1;
+	}
+
+	// Write the parameters to the output file.
+	if ((int)param[0] == 15) {
+		// write an EPS graphic file item
+		if (pcount != 13) {
+			// must have 13 numeric parameters before filename
+			pcount = 13;
+		}
+		// read the next line in the file which contains the filename
+		// the filename may have trailing spaces on its line and may
+		// be padded with spaces to make the length of the filename
+		// be a multiple of 4.
+		text = readLine(input, &end);
+		end  = removeNewline(text, end);
+		textcount = (int)(end - text);
+	}
+
+	return addScoreItem(builder, param, pcount, text, textcount);
+}
+
+
+
+//////////////////////////////
+//
+// readLine -- Return the start of the next line in the input, and
+//    store the position of its newline character (or the end of the
+//    data) in end.  Returns an empty line at the end of the input.
+//
+
+const char* readLine(PmxInput* input, const char** end) {
+	const char* line = input->ptr;
+	const char* newline = (const char*)memchr(line, '\n', input->end - line);
+	if (newline == NULL) {
+		*end = input->end;
+		input->ptr = input->end;
+	} else {
+		*end = newline;
+		input->ptr = newline + 1;
+	}
+	// Text after a null character is ignored (like the C strings that
+	// were previously used to store the line).
+	const char* null = (const char*)memchr(line, '\0', *end - line);
+	if (null != NULL) {
+		*end = null;
+	}
+	return line;
+}
+
+
+
+//////////////////////////////
+//
+// readsNextLine -- Returns 1 if a line from readLine() may be the
+//    parameters of a text item (starting with "t") or is the parameters
+//    of an EPS item, which are followed by a line with the text or the
+//    filename, otherwise 0.  P1 is converted in the same way as by
+//    processInputLine(), so that spellings such as 14.99999999 or 1.5e1
+//    are also EPS items.  A long P1 token is copied into the arena.
+//    Returns -1 if there is not enough memory.
+//
+
+int readsNextLine(const char* line, const char* end, Arena* arena) {
+	if (line == end) {
+		return 0;
+	}
+	if (tolower((unsigned char)line[0]) == 't') {
+		return 1;
+	}
+	if (!isdigit((unsigned char)line[0])) {
+		return 0;
+	}
+	double value;
+	if (parsePmxNumber(&value, &line, end, arena) != 0) {
+		return -1;
+	}
+	return (int)(float)value == SCORE_EPS_ITEM;
+}
+
+
+
+//////////////////////////////
+//
+// removeNewline -- Get rid of any 0x0a or 0x0d characters that may
+//    be hanging around at the end of the line.  Returns the new end
+//    of the line.
+//
+
+static const char* removeNewline(const char* line, const char* end) {
+	while ((end > line) && ((end[-1] == 0x0a) || (end[-1] == 0x0d))) {
+		end--;
+	}
+	return end;
+}
+
+
+
+//////////////////////////////
+//
+// readAsciiNumberLine -- Read a list of numbers on a line of text.
+//      Numbers are separated by spaces or tabs.  Should check for
+//      unexpected text on line after first number.  param must have
+//      space for index + (end - string + 1) / 2 numbers.  Returns the
+//      number of parameters, or -1 if there is not enough memory.
+//
+
+int readAsciiNumberLine(float* param, int index, const char* string,
+		const char* end, Arena* arena) {
+	double value;
+	const char* ptr = string;
+	int counter = index;
+
+	while (1) {
+		while ((ptr < end) && ((*ptr == ' ') || (*ptr == '\t'))) {
+			ptr++;
+		}
+		if (ptr >= end) {
+			break;
+		}
+		if (parsePmxNumber(&value, &ptr, end, arena) != 0) {
+			return -1;
+		}
+		param[counter++] = (float)value;
+	}
+
+	return counter;
+}
+
+
+
+//////////////////////////////
+//
+// parsePmxNumber -- Convert the number token at ptr into a double, and
+//    move ptr to the end of the token.  Returns -1 if there is not
+//    enough memory to copy an unusually long token, otherwise 0.  PMX numbers are fixed-point
+//    decimals, such as "-12.345", which are converted directly: if the
+//    digits form an integer smaller than 2^53, dividing it by the power
+//    of ten gives the correctly rounded value, which is the same value
+//    that strtod() would return.  Anything else (exponents, long numbers,
+//    other trailing characters) is converted with strtod().
+//
+
+static int parsePmxNumber(double* value, const char** ptr, const char* end,
+		Arena* arena) {
+	static const double powersOfTen[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15
+	};
+	const char*        token    = *ptr;
+	const char*        p        = token;
+	int                negative = 0;
+	unsigned long long mantissa = 0;
+	int                digits   = 0;
+	int                fraction = -1;
+	unsigned int       digit;
+
+	if ((*p == '-') || (*p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+	for (; p < end; p++) {
+		digit = (unsigned int)(*p - '0');
+		if (digit < 10) {
+			mantissa = mantissa * 10 + digit;
+			digits++;
+		} else if ((*p == '.') && (fraction < 0)) {
+			fraction = digits;
+		} else {
+			break;
+		}
+	}
+	// A carriage return at the end of the line is also ignored by strtod().
+	const char* stop = p;
+	if ((p == end - 1) && (*p == '\r')) {
+		stop = end;
+	}
+	if (((stop == end) || (*stop == ' ') || (*stop == '\t')) &&
+			(digits > 0) && (digits <= 15)) {
+		*ptr = stop;
+		double number = (double)mantissa;
+		if (fraction >= 0) {
+			number /= powersOfTen[digits - fraction];
+		}
+		*value = negative ? -number : number;
+		return 0;
+	}
+
+	// Unusual syntax: copy the token into a string for strtod().
+	while ((stop < end) && (*stop != ' ') && (*stop != '\t')) {
+		stop++;
+	}
+	*ptr = stop;
+	char   buffer[64];
+	char*  string = buffer;
+	size_t length = stop - token;
+	if (length >= sizeof(buffer)) {
+		string = (char*)allocateArena(arena, length + 1);
+		if (string == NULL) {
+			return -1;
+		}
+	}
+	memcpy(string, token, length);
+	string[length] = '\0';
+	*value = strtod(string, NULL);
+	return 0;
+}
+
+
+
@@ -0,0 +1,35 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Wed Feb 20 14:45:23 PST 2013
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026 moved from pmx2mus.c
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026 store items with ScoreBuilder
+// Last Modified: Thu Oct 15 20:24:20 PDT 2026 export readAsciiNumberLine()
+// Filename:      pmxencode.h
+// Syntax:        C
+//
+// Description:   Convert SCORE PMX text in memory into binary SCORE
+//                items (convertPmxToScore() in libscore.h), and read the
+//                lines of PMX text.
+//
+
+#ifndef _PMXENCODE_H_INCLUDED
+#define _PMXENCODE_H_INCLUDED
+
+#include <stddef.h>
+
+#include "arena.h"
+
+// Position in the PMX input data:
+typedef struct {
+	const char* ptr;   // start of the next line
+	const char* end;   // end of the input data
+} PmxInput;
+
+const char*  readLine             (PmxInput* input, const char** end);
+int          readsNextLine        (const char* line, const char* end,
+                                   Arena* arena);
+int          readAsciiNumberLine  (float* param, int index,
+                                   const char* string, const char* end,
+                                   Arena* arena);
+
+#endif  /* _PMXENCODE_H_INCLUDED */
@@ -0,0 +1,224 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 19:59:16 PDT 2026
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026
+// Filename:      pmxformat.c
+// Syntax:        C
+//
+// Description:   Fast formatting of SCORE parameters as PMX text.  The
+//                functions produce exactly the same characters as the
+//                printf() formats which they replace, but use integer
+//                arithmetic and a digit lookup table instead.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "pmxformat.h"
+
+// function declarations:
+static int writeFixedPoint  (char* output, uint64_t scaled, int negative,
+                             int digits, int width);
+
+// Two-character decimal representations of the numbers 0 to 99:
+static const char digitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const double powersOfTen[] = {
+	1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0, 10000000.0,
+	100000000.0, 1000000000.0
+};
+
+static const uint64_t integerPowersOfTen[] = {
+	1, 10, 100, 1000, 10000
+};
+
+
+
+//////////////////////////////
+//
+// formatPmxParameter -- Write the text that
+//       printf(" %8.3lf", roundFractionDigits(number, 3))
+//    would print for the number.  The output is not null-terminated.
+//    Returns the number of characters written.
+//
+
+int formatPmxParameter(char* output, double number) {
+	if ((number > -PMX_FAST_LIMIT) && (number < PMX_FAST_LIMIT)) {
+		// Same arithmetic as roundFractionDigits(), so that the
+		// rounding of halfway values does not change.
+		if (number < 0.0) {
+			return formatPmxMilli(output, (int)(number * 1000.0 - 0.5));
+		} else {
+			return formatPmxMilli(output, (int)(number * 1000.0 + 0.5));
+		}
+	}
+
+	return snprintf(output, PMX_NUMBER_SIZE, " %8.3lf",
+			roundFractionDigits(number, 3));
+}
+
+
+
+//////////////////////////////
+//
+// formatPmxMilli -- Write the text that printf(" %8.3lf", milli/1000.0)
+//    would print.  This is used for parameters which have already been
+//    rounded to thousandths (see decodeRoundedParameters() in
+//    musdecode.c).  The output is not null-terminated.  Returns the
+//    number of characters written.
+//
+
+int formatPmxMilli(char* output, int milli) {
+	// There is no "-0.000" since roundFractionDigits() returns +0.0
+	// for zero.
+	output[0] = ' ';
+	if (milli < 0) {
+		return 1 + writeFixedPoint(output + 1, -(int64_t)milli, 1, 3, 8);
+	} else {
+		return 1 + writeFixedPoint(output + 1, milli, 0, 3, 8);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// formatPmxFloat -- Write the text that printf("%*.*lf", width, digits)
+//    would print for the value (such as "%1.4lf" and "%2.3lf" for P1).
+//    The value is not rounded beforehand, so the exact binary value
+//    of the float is rounded to the given number of digits, with ties
+//    going to the even digit as printf() does.  The output is not
+//    null-terminated.  Returns the number of characters written.
+//
+
+int formatPmxFloat(char* output, float value, int width, int digits) {
+	union { float f; uint32_t i; } bits;
+	bits.f = value;
+	int      negative = (int)(bits.i >> 31);
+	int      exponent = (int)((bits.i >> 23) & 0xff);
+	uint64_t mantissa = bits.i & 0x7fffff;
+
+	// Only handle finite values smaller than 2^31 here:
+	if ((digits < 0) || (digits > 4) || (exponent >= 127 + 31)) {
+		return snprintf(output, PMX_NUMBER_SIZE, "%*.*lf", width, digits,
+				(double)value);
+	}
+
+	// value = mantissa * 2^exponent
+	if (exponent == 0) {
+		exponent = -149;
+	} else {
+		mantissa |= 0x800000;
+		exponent -= 150;
+	}
+
+	// Multiply by the power of ten before shifting so that the
+	// rounding is done on the exact value.
+	uint64_t product = mantissa * integerPowersOfTen[digits];
+	uint64_t scaled;
+	if (exponent >= 0) {
+		scaled = product << exponent;
+	} else if (exponent < -40) {
+		// product is less than 2^38, so this rounds to zero.
+		scaled = 0;
+	} else {
+		int      shift     = -exponent;
+		uint64_t remainder = product & (((uint64_t)1 << shift) - 1);
+		uint64_t half      = (uint64_t)1 << (shift - 1);
+		scaled = product >> shift;
+		if ((remainder > half) || ((remainder == half) && (scaled & 1))) {
+			scaled++;
+		}
+	}
+
+	return writeFixedPoint(output, scaled, negative, digits, width);
+}
+
+
+
+//////////////////////////////
+//
+// roundFractionDigits -- Round a floating-point number to the speicified
+//    number of siginificant digits after the decimal point.  SCORE binary
+//    values are floats, and they usually contain (roundoff?) junk after
+//    the third digit after the decimal point.
+//
+
+double roundFractionDigits(double number, int digits) {
+	double dshift = powersOfTen[digits];
+	if (number < 0.0) {
+		return ((int)(number * dshift - 0.5))/dshift;
+	} else {
+		return ((int)(number * dshift + 0.5))/dshift;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// writeFixedPoint -- Print scaled/10^digits, right-justified in a field
+//    of the given width.  The digits are generated from right to left,
+//    two at a time from the digitPairs table.
+//
+
+static int writeFixedPoint(char* output, uint64_t scaled, int negative,
+		int digits, int width) {
+	char  buffer[32];
+	char* end = buffer + sizeof(buffer);
+	char* ptr = end;
+
+	uint64_t integer  = scaled / integerPowersOfTen[digits];
+	uint32_t fraction = (uint32_t)(scaled - integer * integerPowersOfTen[digits]);
+
+	// fraction digits:
+	int i = digits;
+	while (i >= 2) {
+		ptr -= 2;
+		memcpy(ptr, &digitPairs[2 * (fraction % 100)], 2);
+		fraction /= 100;
+		i -= 2;
+	}
+	if (i == 1) {
+		*--ptr = (char)('0' + fraction);
+	}
+	if (digits > 0) {
+		*--ptr = '.';
+	}
+
+	// integer digits:
+	while (integer >= 100) {
+		ptr -= 2;
+		memcpy(ptr, &digitPairs[2 * (integer % 100)], 2);
+		integer /= 100;
+	}
+	if (integer >= 10) {
+		ptr -= 2;
+		memcpy(ptr, &digitPairs[2 * integer], 2);
+	} else {
+		*--ptr = (char)('0' + integer);
+	}
+	if (negative) {
+		*--ptr = '-';
+	}
+
+	int length  = (int)(end - ptr);
+	int padding = width > length ? width - length : 0;
+	memset(output, ' ', padding);
+	memcpy(output + padding, ptr, length);
+	return padding + length;
+}
+
+
+
@@ -0,0 +1,30 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 19:59:16 PDT 2026
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026
+// Filename:      pmxformat.h
+// Syntax:        C
+//
+// Description:   Fast formatting of SCORE parameters as PMX text.  The
+//                functions produce exactly the same characters as the
+//                printf() formats which they replace, but use integer
+//                arithmetic and a digit lookup table instead.
+//
+
+#ifndef _PMXFORMAT_H_INCLUDED
+#define _PMXFORMAT_H_INCLUDED
+
+// Size of the output buffer needed for one formatted number.
+#define PMX_NUMBER_SIZE 64
+
+// Values with a magnitude smaller than this are formatted with integer
+// arithmetic.  Larger values (and NaN/infinity) are passed to snprintf().
+#define PMX_FAST_LIMIT 2000000.0
+
+int      formatPmxParameter     (char* output, double number);
+int      formatPmxMilli         (char* output, int milli);
+int      formatPmxFloat         (char* output, float value, int width,
+                                 int digits);
+double   roundFractionDigits    (double number, int digits);
+
+#endif  /* _PMXFORMAT_H_INCLUDED */
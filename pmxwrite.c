@@ -0,0 +1,360 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Wed Aug 29 13:50:35 PDT 2012
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026 moved from mus2pmx.c
+// Last Modified: Thu Oct 15 20:33:08 PDT 2026 convert ranges of items
+// Filename:      pmxwrite.c
+// Syntax:        C
+//
+// Description:   Convert binary SCORE data into PMX text (see
+//                convertScoreToPmx() in libscore.h).  Each item is
+//                formatted in memory and passed to the write function of
+//                the PmxWriter as one piece of text, so the PMX data can
+//                be written to a file or collected in memory.
+//                writePmxHeader() and convertScoreItemsToPmx() do the
+//                two parts of the conversion separately, so that ranges
+//                of items can be converted in parallel.
+//                countScoreItemsToPmx() also counts the items by type
+//                for the statistics of mus2pmx.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "libscore.h"
+#include "pmxformat.h"
+#include "musdecode.h"
+#include "arena.h"
+
+// Arena space needed for each parameter of an item (the decoded value
+// and its text):
+#define ITEM_WORD_BYTES (sizeof(int32_t) + PMX_NUMBER_SIZE)
+
+// Space for the debugging comments of an item:
+#define ITEM_COMMENT_SIZE 128
+
+// function declarations:
+static int      writePmxItem       (PmxWriter* writer, const ScoreItem* item,
+                                    Arena* arena);
+static int      writePmxLine       (PmxWriter* writer, const char* format,
+                                    ...);
+static int      writePmxType       (char* output, double P1);
+static int      formatParameters   (char* output, int32_t* milli,
+                                    const unsigned char* input, int count);
+static int      setPmxError        (PmxWriter* writer, const char* format,
+                                    ...);
+
+
+
+//////////////////////////////
+//
+// convertScoreToPmx -- Convert binary SCORE data into PMX text, which is
+//    passed to writer->write().  Returns 0 if successful, or -1 if there
+//    was an error, with the error message stored in writer->error.
+//    The PMX text of the items before the error has already been
+//    written.
+//
+
+int convertScoreToPmx(PmxWriter* writer, const unsigned char* data,
+		size_t size) {
+	ScoreData score;
+	writer->error[0] = '\0';
+	if (openScoreData(&score, data, size) != 0) {
+		return setPmxError(writer, "%s", score.error);
+	}
+	if (writePmxHeader(writer, &score) != 0) {
+		return -1;
+	}
+	return convertScoreItemsToPmx(writer, &score, score.items, score.itemsEnd);
+}
+
+
+
+//////////////////////////////
+//
+// writePmxHeader -- Write the comment lines at the start of the PMX text
+//    for the options in writer->flags (the ##UNITS:, ##VERSION: and
+//    ##SERIAL: lines from the trailer, and the debugging comments).
+//    Returns 0 if successful.
+//
+
+int writePmxHeader(PmxWriter* writer, const ScoreData* score) {
+	if (writer->flags & SCORE_PMX_DEBUG) {
+		if ((writePmxLine(writer, "#number count is %d\n",
+					score->numberCount) != 0) ||
+				(writePmxLine(writer, "#trailer end number is %.1lf\n",
+					-9999.0) != 0) ||
+				(writePmxLine(writer, "#trailer size is %.1lf\n",
+					score->trailerSize) != 0) ||
+				(writePmxLine(writer, "#unit type is %.1lf\n",
+					score->units) != 0)) {
+			return -1;
+		}
+	}
+
+	if (writer->flags & SCORE_PMX_HEADER) {
+		if ((score->units == 0.0) &&
+				(writePmxLine(writer, "##UNITS:\tinches\n") != 0)) {
+			return -1;
+		}
+		if ((score->units == 1.0) &&
+				(writePmxLine(writer, "##UNITS:\tcentimeters\n") != 0)) {
+			return -1;
+		}
+		if (writePmxLine(writer, "##VERSION:\t%.2lf\n", score->version) != 0) {
+			return -1;
+		}
+		// SCORE version 4 (and higher) contains a serial number of the
+		// program used to create the data file.
+		if ((score->trailerSize > 4.0) &&
+				(writePmxLine(writer, "##SERIAL:\t%lf\n", score->serial) != 0)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// convertScoreItemsToPmx -- Convert the items from start to end (which
+//    must be at the start of an item, or score->itemsEnd) into PMX text.
+//    Returns 0 if successful, or -1 if there was an error, with the
+//    error message stored in writer->error.  The PMX text of the items
+//    before the error has already been written.
+//
+
+int convertScoreItemsToPmx(PmxWriter* writer, const ScoreData* score,
+		const unsigned char* start, const unsigned char* end) {
+	return countScoreItemsToPmx(writer, score, start, end, NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// countScoreItemsToPmx -- Same as convertScoreItemsToPmx(), and also
+//    count the items which are converted by the integer part of P1:
+//    counts[(int)P1] for types from 0 to types - 1, and counts[types]
+//    for all other items.  Nothing is counted if counts is NULL.
+//
+
+int countScoreItemsToPmx(PmxWriter* writer, const ScoreData* score,
+		const unsigned char* start, const unsigned char* end, long* counts,
+		int types) {
+	writer->error[0] = '\0';
+
+	// No item can be longer than the range, so the arena starts with
+	// enough space for any item of smaller ranges.  For larger ranges it
+	// starts with space for 4096 parameters and grows when a longer item
+	// is found.
+	size_t itemWords = (size_t)(end - start) / 4;
+	size_t itemLimit = itemWords < 4096 ? itemWords : 4096;
+	Arena  arena;
+	initArena(&arena, itemLimit * ITEM_WORD_BYTES + ITEM_COMMENT_SIZE + 64);
+
+	ScoreIterator iterator;
+	ScoreItem     item;
+	int           status = 0;
+	beginScoreItems(&iterator, score);
+	iterator.ptr = start;
+	while ((iterator.ptr < end) &&
+			((status = nextScoreItem(&iterator, &item)) > 0)) {
+		if (writePmxItem(writer, &item, &arena) != 0) {
+			break;
+		}
+		if (counts != NULL) {
+			int type = (int)item.P1;
+			counts[((type >= 0) && (type < types)) ? type : types]++;
+		}
+		resetArena(&arena);
+	}
+	freeArena(&arena);
+
+	if (status < 0) {
+		return setPmxError(writer, "%s", iterator.error);
+	}
+	return writer->error[0] ? -1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// writePmxToFile -- Write function for a PmxWriter which writes to a
+//    FILE* given as the context.
+//
+
+int writePmxToFile(void* file, const char* text, size_t size) {
+	return fwrite(text, sizeof(char), size, (FILE*)file) == size ? 0 : -1;
+}
+
+
+
+//////////////////////////////
+//
+// writePmxItem -- Format one item as PMX text.  Text items use "t"
+//    instead of "16.0" for P1, and are followed by a line containing the
+//    text.  EPS graphic items are followed by a line containing the
+//    filename.  Parameter 13 of EPS items should probably not be printed
+//    in the PMX data since it is only used to edit the filename in the
+//    SCORE editor (but currently is).  Returns 0 if successful.
+//
+
+static int writePmxItem(PmxWriter* writer, const ScoreItem* item,
+		Arena* arena) {
+	// P1 == parameter 1, which is the item type
+	double P1 = item->P1;
+	if (P1 <= 0.0) {
+		return setPmxError(writer, "Strange error: P1 is non-positive: %lf",
+				P1);
+	}
+	if (P1 >= 100.0) {
+		return setPmxError(writer, "Strange error: P1 is way too large: %lf",
+				P1);
+	}
+
+	int      count  = item->parameterCount - 1;
+	int      debug  = writer->flags & SCORE_PMX_DEBUG;
+	int32_t* milli  = (int32_t*)allocateArena(arena, count * sizeof(int32_t));
+	char*    buffer = (char*)allocateArena(arena, (size_t)(count + 1) *
+			PMX_NUMBER_SIZE + item->textLength + ITEM_COMMENT_SIZE + 2);
+	if ((milli == NULL) || (buffer == NULL)) {
+		return setPmxError(writer,
+				"Error: out of memory for item with %d parameters", item->count);
+	}
+
+	char* ptr = buffer;
+	if (debug) {
+		ptr += sprintf(ptr, "# next item has %d parameters\n", item->count);
+	}
+	if (P1 == SCORE_TEXT_ITEM) {
+		memcpy(ptr, "t     ", 6);
+		ptr += 6;
+	} else {
+		ptr += writePmxType(ptr, P1);
+	}
+	ptr += formatParameters(ptr, milli, item->parameters + 4, count);
+	*ptr++ = '\n';
+
+	if (item->text != NULL) {
+		// The string length (P12) of text items was checked when
+		// reading the item.
+		int characterCount = (int)roundFractionDigits(
+				getScoreParameter(item, 12), 3);
+		if (debug && (P1 == SCORE_TEXT_ITEM)) {
+			ptr += sprintf(ptr, "# String length is %d\n", characterCount);
+		}
+		memcpy(ptr, item->text, item->textLength);
+		ptr += item->textLength;
+		*ptr++ = '\n';
+		// The padding bytes after the text should be spaces, but can
+		// occasionally be non-zero, so they are ignored.
+		if (debug && (P1 == SCORE_TEXT_ITEM)) {
+			ptr += sprintf(ptr, "#Extra padding bytes after string is %d\n",
+					4 - characterCount % 4);
+		}
+	}
+
+	if (writer->write(writer->context, buffer, ptr - buffer) != 0) {
+		return setPmxError(writer, "Error: cannot write PMX data");
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// writePmxType -- Format P1 of a non-text item at the start of a line.
+//    Returns the number of characters written.
+//
+
+static int writePmxType(char* output, double P1) {
+	if (P1 < 10) {
+		// The first character on the line for a PMX should not be a space.
+		// The fractional value is usually not used (always .0000).  But
+		// Walter's data and the newest Windows SCORE files may contain
+		// non-zero fraction digits which describe the layer number of
+		// the items on the staff.
+		return formatPmxFloat(output, (float)P1, 1, 4);
+	} else {
+		return formatPmxFloat(output, (float)P1, 2, 3);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// formatParameters -- Decode and round count parameters at once into
+//    milli, then format them in PMX style.  Returns the number of
+//    characters written.
+//
+
+static int formatParameters(char* output, int32_t* milli,
+		const unsigned char* input, int count) {
+	int length = 0;
+	int i;
+	if (decodeRoundedParameters(milli, input, count) == 0) {
+		for (i=0; i<count; i++) {
+			length += formatPmxMilli(output + length, milli[i]);
+		}
+		return length;
+	}
+	// Some values are too large to be rounded with integer arithmetic:
+	float value;
+	for (i=0; i<count; i++) {
+		if (milli[i] != MUS_MILLI_INVALID) {
+			length += formatPmxMilli(output + length, milli[i]);
+		} else {
+			decodeLittleFloats(&value, input + 4 * i, 1);
+			length += formatPmxParameter(output + length, value);
+		}
+	}
+	return length;
+}
+
+
+
+//////////////////////////////
+//
+// writePmxLine -- Format a line of text and pass it to the writer.
+//    Returns 0 if successful.
+//
+
+static int writePmxLine(PmxWriter* writer, const char* format, ...) {
+	char    buffer[256];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if ((length < 0) || (length >= (int)sizeof(buffer)) ||
+			(writer->write(writer->context, buffer, length) != 0)) {
+		return setPmxError(writer, "Error: cannot write PMX data");
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// setPmxError -- Store an error message in the writer.  Returns -1 so
+//     that it can be used as a return value.
+//
+
+static int setPmxError(PmxWriter* writer, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	vsnprintf(writer->error, sizeof(writer->error), format, args);
+	va_end(args);
+	return -1;
+}
+
+
+
@@ -0,0 +1,355 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:27:09 PDT 2026
+// Last Modified: Thu Oct 15 20:27:09 PDT 2026
+// Filename:      runstats.c
+// Syntax:        C
+//
+// Description:   Statistics of a conversion run for the --stats option of
+//                mus2pmx and pmx2mus (see runstats.h).  The statistics of
+//                each file are collected without locking by the thread
+//                converting it, and then added to the totals with
+//                addFileStats().
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "runstats.h"
+#include "trace.h"
+
+// Names of the P1 item types for the report:
+static const char* itemNames[STATS_P1_TYPES] = {
+	NULL,      "note",    "rest",    "clef",    "line",    "slur",
+	"beam",    "trill",   "staff",   "symbol",  "number",  NULL,
+	NULL,      NULL,      "barline", "eps",     "text",    "keysig",
+	"meter"
+};
+
+static const char* phaseNames[STATS_PHASES] = {
+	"read", "decode", "format", "write"
+};
+
+// function declarations:
+static void     addItemCount         (FileStats* file, double P1);
+static double   getFileSeconds       (const FileStats* file);
+static void     writeStatsText       (const RunStats* stats, FILE* output);
+static void     writeStatsJson       (const RunStats* stats, FILE* output);
+
+
+
+//////////////////////////////
+//
+// initRunStats -- Start collecting statistics for a run.  slowest is
+//    the number of files to list in the report as the slowest ones.
+//
+
+void initRunStats(RunStats* stats, const char* program, int slowest) {
+	memset(stats, 0, sizeof(RunStats));
+	stats->program      = program;
+	stats->slowestLimit = slowest > 0 ? slowest : 0;
+	stats->slowest      = (FileStats*)malloc((stats->slowestLimit + 1) *
+			sizeof(FileStats));
+	pthread_mutex_init(&stats->mutex, NULL);
+	stats->start = getStatsTime();
+}
+
+
+
+//////////////////////////////
+//
+// freeRunStats -- Free the memory used by the statistics.
+//
+
+void freeRunStats(RunStats* stats) {
+	int i;
+	for (i=0; i<stats->slowestCount; i++) {
+		free(stats->slowest[i].filename);
+	}
+	free(stats->slowest);
+	stats->slowest      = NULL;
+	stats->slowestCount = 0;
+	pthread_mutex_destroy(&stats->mutex);
+}
+
+
+
+//////////////////////////////
+//
+// writeRunStats -- Write the report to standard error as text, or to
+//    a file as JSON if jsonfile is not NULL.  Returns 0 if successful.
+//
+
+int writeRunStats(RunStats* stats, const char* jsonfile) {
+	if (jsonfile == NULL) {
+		writeStatsText(stats, stderr);
+		return 0;
+	}
+	FILE* output = fopen(jsonfile, "w");
+	if (output == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for writing.\n", jsonfile);
+		return -1;
+	}
+	writeStatsJson(stats, output);
+	if (fclose(output) != 0) {
+		fprintf(stderr, "Error: cannot write file %s.\n", jsonfile);
+		return -1;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// beginFileStats -- Clear the statistics for a file.
+//
+
+void beginFileStats(FileStats* file, const char* filename) {
+	memset(file, 0, sizeof(FileStats));
+	file->filename = (char*)filename;
+}
+
+
+
+//////////////////////////////
+//
+// addFileStats -- Add the statistics of a file to the totals (called
+//    from any thread).
+//
+
+void addFileStats(RunStats* stats, FileStats* file) {
+	int i;
+	pthread_mutex_lock(&stats->mutex);
+	stats->files++;
+	stats->failures     += file->failed ? 1 : 0;
+	stats->bytesRead    += file->bytesRead;
+	stats->bytesWritten += file->bytesWritten;
+	for (i=0; i<STATS_PHASES; i++) {
+		stats->seconds[i] += file->seconds[i];
+	}
+	for (i=0; i<=STATS_P1_TYPES; i++) {
+		stats->items[i] += file->items[i];
+	}
+
+	// Insert the file into the list of the slowest files:
+	double seconds = getFileSeconds(file);
+	int position = stats->slowestCount;
+	while ((position > 0) &&
+			(getFileSeconds(&stats->slowest[position-1]) < seconds)) {
+		position--;
+	}
+	if (position < stats->slowestLimit) {
+		if (stats->slowestCount == stats->slowestLimit) {
+			free(stats->slowest[--stats->slowestCount].filename);
+		}
+		memmove(stats->slowest + position + 1, stats->slowest + position,
+				(stats->slowestCount - position) * sizeof(FileStats));
+		stats->slowest[position] = *file;
+		stats->slowest[position].filename = strdup(file->filename ?
+				file->filename : "");
+		stats->slowestCount++;
+	}
+	pthread_mutex_unlock(&stats->mutex);
+}
+
+
+
+//////////////////////////////
+//
+// getStatsTime -- Return the time in seconds from a monotonic clock.
+//
+
+double getStatsTime(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+
+//////////////////////////////
+//
+// addPhaseTime -- Add the time since start to a phase of the file.
+//    Returns the current time, which can be used as the start of the
+//    next phase.
+//
+
+double addPhaseTime(FileStats* file, int phase, double start) {
+	double now = getStatsTime();
+	file->seconds[phase] += now - start;
+	return now;
+}
+
+
+
+//////////////////////////////
+//
+// countScoreItems -- Count the items of binary SCORE data by their P1
+//    type.  Nothing is counted if the data is not valid.
+//
+
+void countScoreItems(FileStats* file, const unsigned char* data,
+		size_t size) {
+	ScoreData     score;
+	ScoreIterator iterator;
+	ScoreItem     item;
+	if (openScoreData(&score, data, size) != 0) {
+		return;
+	}
+	beginScoreItems(&iterator, &score);
+	while (nextScoreItem(&iterator, &item) > 0) {
+		addItemCount(file, item.P1);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// addItemCount -- Count an item by the integer part of its P1 (the
+//    fraction digits are used for the layer of an item).
+//
+
+static void addItemCount(FileStats* file, double P1) {
+	int type = (int)P1;
+	if ((type >= 0) && (type < STATS_P1_TYPES)) {
+		file->items[type]++;
+	} else {
+		file->items[STATS_P1_TYPES]++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// writeWithStats -- Write function for a PmxWriter which has a
+//    StatsWriter as its context.
+//
+
+int writeWithStats(void* context, const char* text, size_t size) {
+	StatsWriter* writer = (StatsWriter*)context;
+	double start  = getStatsTime();
+	int    status = writer->write(writer->context, text, size);
+	addPhaseTime(writer->stats, STATS_WRITE, start);
+	writer->stats->bytesWritten += size;
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// getFileSeconds -- Return the total time of all phases of a file.
+//
+
+static double getFileSeconds(const FileStats* file) {
+	double seconds = 0.0;
+	int i;
+	for (i=0; i<STATS_PHASES; i++) {
+		seconds += file->seconds[i];
+	}
+	return seconds;
+}
+
+
+
+//////////////////////////////
+//
+// writeStatsText -- Write the report in a readable form.  The phase
+//    times are added over all threads, so they can be larger than the
+//    wall-clock time of the run.
+//
+
+static void writeStatsText(const RunStats* stats, FILE* output) {
+	double wall = getStatsTime() - stats->start;
+	int i;
+	fprintf(output, "%s statistics:\n", stats->program);
+	fprintf(output, "   files:          %d (%d failed)\n", stats->files,
+			stats->failures);
+	fprintf(output, "   bytes read:     %zu (%.2lf MB/s)\n", stats->bytesRead,
+			wall > 0.0 ? stats->bytesRead / 1e6 / wall : 0.0);
+	fprintf(output, "   bytes written:  %zu (%.2lf MB/s)\n",
+			stats->bytesWritten,
+			wall > 0.0 ? stats->bytesWritten / 1e6 / wall : 0.0);
+	fprintf(output, "   wall time:      %.6lf s\n", wall);
+	for (i=0; i<STATS_PHASES; i++) {
+		fprintf(output, "   %s time:%*s%.6lf s\n", phaseNames[i],
+				(int)(10 - strlen(phaseNames[i])), "", stats->seconds[i]);
+	}
+	fprintf(output, "   items by P1:\n");
+	for (i=0; i<=STATS_P1_TYPES; i++) {
+		if (stats->items[i] == 0) {
+			continue;
+		}
+		if (i == STATS_P1_TYPES) {
+			fprintf(output, "      other     %10ld\n", stats->items[i]);
+		} else {
+			fprintf(output, "      %2d %-7s%10ld\n", i,
+					itemNames[i] ? itemNames[i] : "", stats->items[i]);
+		}
+	}
+	if (stats->slowestCount > 0) {
+		fprintf(output, "   slowest files:\n");
+	}
+	for (i=0; i<stats->slowestCount; i++) {
+		fprintf(output, "      %.6lf s  %s\n",
+				getFileSeconds(&stats->slowest[i]), stats->slowest[i].filename);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// writeStatsJson -- Write the report as a JSON object.
+//
+
+static void writeStatsJson(const RunStats* stats, FILE* output) {
+	int i, j;
+	fprintf(output, "{\"program\":");
+	writeJsonString(output, stats->program);
+	fprintf(output, ",\"files\":%d,\"failures\":%d", stats->files,
+			stats->failures);
+	fprintf(output, ",\"bytesRead\":%zu,\"bytesWritten\":%zu",
+			stats->bytesRead, stats->bytesWritten);
+	fprintf(output, ",\"seconds\":{\"wall\":%.6lf",
+			getStatsTime() - stats->start);
+	for (i=0; i<STATS_PHASES; i++) {
+		fprintf(output, ",\"%s\":%.6lf", phaseNames[i], stats->seconds[i]);
+	}
+	fprintf(output, "},\"items\":{");
+	const char* separator = "";
+	for (i=0; i<=STATS_P1_TYPES; i++) {
+		if (stats->items[i] == 0) {
+			continue;
+		}
+		if (i == STATS_P1_TYPES) {
+			fprintf(output, "%s\"other\":%ld", separator, stats->items[i]);
+		} else {
+			fprintf(output, "%s\"%d\":%ld", separator, i, stats->items[i]);
+		}
+		separator = ",";
+	}
+	fprintf(output, "},\"slowest\":[");
+	for (i=0; i<stats->slowestCount; i++) {
+		const FileStats* file = &stats->slowest[i];
+		fprintf(output, "%s{\"file\":", i ? "," : "");
+		writeJsonString(output, file->filename);
+		fprintf(output, ",\"failed\":%s,\"bytesRead\":%zu,\"bytesWritten\":%zu",
+				file->failed ? "true" : "false", file->bytesRead,
+				file->bytesWritten);
+		fprintf(output, ",\"seconds\":%.6lf", getFileSeconds(file));
+		for (j=0; j<STATS_PHASES; j++) {
+			fprintf(output, ",\"%s\":%.6lf", phaseNames[j], file->seconds[j]);
+		}
+		fprintf(output, "}");
+	}
+	fprintf(output, "]}\n");
+}
+
+
+
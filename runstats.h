@@ -0,0 +1,85 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:27:09 PDT 2026
+// Last Modified: Thu Oct 15 20:27:09 PDT 2026
+// Filename:      runstats.h
+// Syntax:        C
+//
+// Description:   Statistics of a conversion run for the --stats option of
+//                mus2pmx and pmx2mus: bytes read and written, the number
+//                of items of each P1 type, the time spent in each phase
+//                of the conversion, and the slowest files.  The programs
+//                only call these functions when --stats is given.
+//
+
+#ifndef _RUNSTATS_H_INCLUDED
+#define _RUNSTATS_H_INCLUDED
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "libscore.h"
+
+// Phases of the conversion of a file:
+#define STATS_READ    0   // opening and mapping the input file
+#define STATS_DECODE  1   // reading the input data (the count and trailer
+                          // for mus2pmx, the PMX text for pmx2mus)
+#define STATS_FORMAT  2   // creating the output data
+#define STATS_WRITE   3   // writing the output data
+#define STATS_PHASES  4
+
+// Items with the integer part of P1 below this are counted by type, and
+// others are counted together:
+#define STATS_P1_TYPES 32
+
+// Default number of files listed as the slowest ones:
+#define STATS_SLOWEST 10
+
+// Statistics of one input file (or one page for pmx2mus):
+typedef struct {
+	char*  filename;
+	int    failed;
+	size_t bytesRead;
+	size_t bytesWritten;
+	double seconds[STATS_PHASES];
+	long   items[STATS_P1_TYPES + 1];
+} FileStats;
+
+// Totals for all files:
+typedef struct {
+	const char*     program;
+	int             files;
+	int             failures;
+	size_t          bytesRead;
+	size_t          bytesWritten;
+	double          start;
+	double          seconds[STATS_PHASES];
+	long            items[STATS_P1_TYPES + 1];
+	FileStats*      slowest;        // sorted from slowest to fastest
+	int             slowestCount;
+	int             slowestLimit;
+	pthread_mutex_t mutex;
+} RunStats;
+
+// Passes the PMX text of convertScoreToPmx() on to another writer, and
+// adds the time and size of the writes to the file statistics:
+typedef struct {
+	ScoreWriteFunction write;
+	void*              context;
+	FileStats*         stats;
+} StatsWriter;
+
+void     initRunStats        (RunStats* stats, const char* program,
+                              int slowest);
+void     freeRunStats        (RunStats* stats);
+int      writeRunStats       (RunStats* stats, const char* jsonfile);
+void     beginFileStats      (FileStats* file, const char* filename);
+void     addFileStats        (RunStats* stats, FileStats* file);
+double   getStatsTime        (void);
+double   addPhaseTime        (FileStats* file, int phase, double start);
+void     countScoreItems     (FileStats* file, const unsigned char* data,
+                              size_t size);
+int      writeWithStats      (void* context, const char* text,
+                              size_t size);
+
+#endif  /* _RUNSTATS_H_INCLUDED */
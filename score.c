@@ -0,0 +1,572 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:18:57 PDT 2026
+// Last Modified: Thu Oct 15 20:20:29 PDT 2026 added trailer probe
+// Last Modified: Thu Oct 15 20:35:21 PDT 2026 added appendScoreItems()
+// Filename:      score.c
+// Syntax:        C
+//
+// Description:   Reading and writing binary SCORE data in memory (see
+//                libscore.h).  The file structure is:
+//                   * A count of the 4-byte words which follow (2 bytes,
+//                     or 4 bytes in large WinSCORE files, which are the
+//                     files with a size that is a multiple of 4).
+//                   * The items, each of which is a word count followed
+//                     by that many words (P1, P2, ...).
+//                   * The trailer: 0.0, (serial number), version, units,
+//                     the trailer size, and -9999.0.
+//                All numbers are little-endian 4-byte floats.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "libscore.h"
+#include "pmxformat.h"
+#include "musdecode.h"
+#include "mapfile.h"
+
+// function declarations:
+static int      setScoreError     (char* error, const char* format, ...);
+static int      reserveScoreData  (ScoreBuilder* builder, size_t size);
+static void     storeLittleFloat  (unsigned char* bytes, float value);
+static void     storeLittleInt    (unsigned char* bytes, int value);
+static void     storeLittleShort  (unsigned char* bytes, int value);
+static int      loadLittleShort   (const unsigned char* bytes);
+static int      loadLittleInt     (const unsigned char* bytes);
+static double   loadLittleFloat   (const unsigned char* bytes);
+
+
+
+//////////////////////////////
+//
+// openScoreData -- Check the count field and trailer of binary SCORE
+//    data, and find the region of the data which contains the items.
+//    The data is not copied, so it must remain available while the
+//    ScoreData is used.  Returns 0 if successful, or -1 with an error
+//    message in score->error.
+//
+
+int openScoreData(ScoreData* score, const unsigned char* data, size_t size) {
+	const unsigned char* tail = size >= SCORE_PROBE_TAIL ?
+			data + size - SCORE_PROBE_TAIL : data;
+	if (probeScoreData(score, data, tail, size) != 0) {
+		return -1;
+	}
+	score->data     = data;
+	score->items    = data + score->countSize;
+	score->itemsEnd = score->items + 4 * (size_t)(score->numberCount -
+			(int)score->trailerSize - 1);
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// probeScoreData -- Read the count field and the trailer of binary SCORE
+//    data from the first SCORE_PROBE_HEAD bytes (head) and the last
+//    SCORE_PROBE_TAIL bytes (tail) of the data, where size is the size
+//    of the complete data.  The data pointers of the score are set to
+//    NULL.  Returns 0 if successful, or -1 with an error message in
+//    score->error.
+//
+
+int probeScoreData(ScoreData* score, const unsigned char* head,
+		const unsigned char* tail, size_t size) {
+	memset(score, 0, sizeof(ScoreData));
+	score->size = size;
+
+	// The smallest possible file is a count field followed by a
+	// four-number trailer (and the -9999.0 end marker).
+	if (size < 22) {
+		return setScoreError(score->error,
+				"Error: file is too small to be a SCORE file.");
+	}
+
+	// First read the number of 4-byte numbers (or 4-character groupings)
+	// which are found in the file after this number.  The size of this
+	// number is 2 bytes for all files created with DOS versions of SCORE.
+	// For Windows versions of SCORE, it is possible that this number can
+	// be 4 bytes wide if the number of 4-byte values in the file exceeds
+	// 0xffff.  If the file size mod 4 has a remainder of 0, then the
+	// count field is four bytes instead of two.
+	if (size % 4 == 0) {
+		score->countSize   = 4;
+		score->numberCount = loadLittleInt(head);
+	} else {
+		score->countSize   = 2;
+		score->numberCount = loadLittleShort(head);
+	}
+
+	// All SCORE binary files must end in the hex bytes "00 3c 1c c6"
+	// which represents the floating point number -9999.0.
+	const unsigned char* end = tail + SCORE_PROBE_TAIL;
+	double lastNumber = loadLittleFloat(end - 4);
+	if (lastNumber != -9999.0) {
+		return setScoreError(score->error,
+				"Error: last number is not -9999.0: %.1lf", lastNumber);
+	}
+
+	// Now read the trailer of the file.  There should be at least 5
+	// numbers.  In reverse order from the end of the file, these are:
+	//    number 1: The number of floats in the trailer (including
+	//              this value.  Standard value is "5.0"  For future
+	//              versions of SCORE, this value might be larger, but
+	//              it will never be smaller.  Numbers 2, 3, and 4 will
+	//              always have a fixed meaning in any future versions
+	//              of SCORE, and extra parameters will be added before
+	//              them in the file if this value is larger than 5.0.
+	//              SCORE version 3 files have a 4-number trailer
+	//              without a serial number.
+	//    number 2: The measurement code: 0.0 = inches, 1.0 = centimeters.
+	//              This is needed for certain length measurements for
+	//              certain items (not often used).
+	//    number 3: Program version number which created the file.
+	//    number 4: Program serial number which created the file.
+	//    number 5: The last number in the trailer (i.e., the first
+	//              trailer byte within the file) must be set to 0.0;
+	//              This is an alternate way of identifying the trailer
+	//              after a list of items.  No item should have a
+	//              parameter size of 0.0, so a parameter size of 0.0
+	//              would indicate the end of the data and the start
+	//              of the trailer.
+	score->trailerSize = loadLittleFloat(end - 8);
+	if (score->trailerSize < 4.0) {
+		return setScoreError(score->error,
+				"Error: trailer size is too small: %.1lf", score->trailerSize);
+	}
+	if (score->trailerSize > 5.0) {
+		return setScoreError(score->error,
+				"Error: trailer size is too large: %.1lf", score->trailerSize);
+	}
+	score->units   = loadLittleFloat(end - 12);
+	score->version = loadLittleFloat(end - 16);
+	if (score->trailerSize > 4.0) {
+		score->serial = loadLittleFloat(end - 20);
+	}
+
+	// The items occupy the words between the count field and the trailer.
+	// Check once that this region lies inside of the file, so that the
+	// parameters of each item can be read without further bounds checks.
+	// The count is compared before subtracting, since a corrupt 4-byte
+	// count may be negative.
+	if (score->numberCount <= (int)score->trailerSize) {
+		return setScoreError(score->error,
+				"Error: item data overlaps with trailer contents");
+	}
+	if ((size_t)score->countSize + 4 * (size_t)score->numberCount > size) {
+		return setScoreError(score->error,
+				"Error: number count %d is larger than file size",
+				score->numberCount);
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// probeScoreFile -- Read the count field and the trailer of a binary
+//    SCORE file (see probeScoreData()) without reading the items.  Only
+//    the first SCORE_PROBE_HEAD bytes and the last SCORE_PROBE_TAIL
+//    bytes of the file are read.  Returns 0 if successful, or -1 with
+//    an error message in score->error.
+//
+
+int probeScoreFile(ScoreData* score, const char* filename) {
+	unsigned char head[SCORE_PROBE_HEAD];
+	unsigned char tail[SCORE_PROBE_TAIL];
+	size_t        size = 0;
+	if (readFileEnds(filename, head, sizeof(head), tail, sizeof(tail),
+			&size) != 0) {
+		memset(score, 0, sizeof(ScoreData));
+		return setScoreError(score->error,
+				"Error: cannot open file %s for reading.", filename);
+	}
+	return probeScoreData(score, head, tail, size);
+}
+
+
+
+//////////////////////////////
+//
+// beginScoreItems -- Prepare to read the items of the data with
+//    nextScoreItem().
+//
+
+void beginScoreItems(ScoreIterator* iterator, const ScoreData* score) {
+	iterator->score    = score;
+	iterator->ptr      = score->items;
+	iterator->error[0] = '\0';
+}
+
+
+
+//////////////////////////////
+//
+// nextScoreItem -- Read the next item.  Returns 1 if an item was read,
+//    0 at the end of the items, or -1 if the data is invalid (with an
+//    error message in iterator->error).
+//
+
+int nextScoreItem(ScoreIterator* iterator, ScoreItem* item) {
+	const unsigned char* ptr      = iterator->ptr;
+	const unsigned char* itemsEnd = iterator->score->itemsEnd;
+	if (ptr >= itemsEnd) {
+		return 0;
+	}
+
+	// Number of numbers (4-byte chunks of data) in the item:
+	int count = (int)roundFractionDigits(loadLittleFloat(ptr), 3);
+	if (count == 0) {
+		return setScoreError(iterator->error,
+				"Error: parameter size of next item is zero.");
+	}
+	// The whole item has to fit before the trailer:
+	if ((count < 0) || ((size_t)(itemsEnd - ptr) / 4 - 1 < (size_t)count)) {
+		return setScoreError(iterator->error,
+				"Error: item data overlaps with trailer contents");
+	}
+
+	item->start          = ptr;
+	item->count          = count;
+	item->parameters     = ptr + 4;
+	item->P1             = loadLittleFloat(item->parameters);
+	item->parameterCount = count;
+	item->text           = NULL;
+	item->textLength     = 0;
+
+	if (item->P1 == SCORE_TEXT_ITEM) {
+		// P1 to P13 are followed by the text, and P12 is the number of
+		// characters in the text.
+		if (count < 13) {
+			return setScoreError(iterator->error,
+					"Error reading binary text item: there must be 13 fixed "
+					"parameters, but there are instead %d.", count - 1);
+		}
+		int characterCount = (int)roundFractionDigits(
+				loadLittleFloat(item->parameters + 44), 3);
+		if ((characterCount < 0) || (characterCount > (count - 13) * 4)) {
+			return setScoreError(iterator->error,
+					"Error: text string length %d does not fit in item.",
+					characterCount);
+		}
+		item->parameterCount = 13;
+		item->text       = (const char*)item->parameters + 52;
+		item->textLength = (int)strnlen(item->text, characterCount);
+	} else if (item->P1 == SCORE_EPS_ITEM) {
+		// P1 to P13 are followed by the filename.  P13 is only used to
+		// edit the filename in the SCORE editor.
+		if (count < 13) {
+			return setScoreError(iterator->error,
+					"Error: EPS graphic item has too few parameters");
+		}
+		if (count == 13) {
+			return setScoreError(iterator->error,
+					"Error: expecting non-zero count for P1=15 filename");
+		}
+		item->parameterCount = 13;
+		item->text = (const char*)item->parameters + 52;
+		int length = (int)strnlen(item->text, (count - 13) * 4);
+		// remove any trailing spaces in filename
+		while ((length > 0) && (item->text[length - 1] == ' ')) {
+			length--;
+		}
+		item->textLength = length;
+	}
+
+	iterator->ptr = item->parameters + 4 * (size_t)count;
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// getScoreParameter -- Return a parameter of an item, where number is
+//    1 for P1, 2 for P2, and so on.
+//
+
+float getScoreParameter(const ScoreItem* item, int number) {
+	return (float)loadLittleFloat(item->parameters + 4 * (number - 1));
+}
+
+
+
+//////////////////////////////
+//
+// getScoreParameters -- Store the item->parameterCount numeric
+//    parameters of an item in output.
+//
+
+void getScoreParameters(const ScoreItem* item, float* output) {
+	decodeLittleFloats(output, item->parameters, item->parameterCount);
+}
+
+
+
+//////////////////////////////
+//
+// initScoreBuilder -- Prepare to create binary SCORE data.  size is the
+//    expected size of the data (the data can grow larger).
+//
+
+void initScoreBuilder(ScoreBuilder* builder, size_t size) {
+	memset(builder, 0, sizeof(ScoreBuilder));
+	// Four bytes are reserved for the count, since its size (2 or 4
+	// bytes) is not known until all items have been added.
+	if (reserveScoreData(builder, size + 4) == 0) {
+		memset(builder->data, 0, 4);
+		builder->size = 4;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// addScoreItem -- Add an item with count numeric parameters (starting
+//    with P1), followed by textLength characters of text (for text and
+//    EPS graphic items, otherwise text can be NULL).  The text is padded
+//    with spaces to a multiple of 4 bytes.  For text items, P12 should
+//    be the number of characters in the text.  Returns 0 if successful,
+//    or -1 if out of memory.
+//
+
+int addScoreItem(ScoreBuilder* builder, const float* parameters, int count,
+		const char* text, size_t textLength) {
+	size_t textBlocks = (textLength + 3) / 4;
+	if (reserveScoreData(builder, 4 * (count + 1 + textBlocks)) != 0) {
+		return -1;
+	}
+	unsigned char* ptr = builder->data + builder->size;
+	storeLittleFloat(ptr, (float)(count + textBlocks));
+	ptr += 4;
+	int i;
+	for (i=0; i<count; i++) {
+		storeLittleFloat(ptr, parameters[i]);
+		ptr += 4;
+	}
+	if (textLength > 0) {
+		// store spaces in dummy charater spots to fill out a block of four
+		// bytes at the end of the text item string (or EPS filename).
+		memcpy(ptr, text, textLength);
+		memset(ptr + textLength, ' ', textBlocks * 4 - textLength);
+	}
+	builder->size  += 4 * (count + 1 + textBlocks);
+	builder->count += (int)(count + 1 + textBlocks);
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// appendScoreItems -- Add the items of another builder (which has not
+//    been finished) after the items of the builder.  Returns 0 if
+//    successful, or -1 if out of memory.
+//
+
+int appendScoreItems(ScoreBuilder* builder, const ScoreBuilder* items) {
+	if (items->error) {
+		builder->error = 1;
+		return -1;
+	}
+	// The first four bytes of items are reserved for its count field.
+	size_t size = items->size - 4;
+	if (reserveScoreData(builder, size) != 0) {
+		return -1;
+	}
+	memcpy(builder->data + builder->size, items->data + 4, size);
+	builder->size  += size;
+	builder->count += items->count;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// finishScoreData -- Add the trailer and the count field.  The
+//    finished data is stored in data and size (it is freed with
+//    freeScoreBuilder()).  Returns 0 if successful, or -1 if there was
+//    not enough memory for the data.
+//
+
+int finishScoreData(ScoreBuilder* builder, const unsigned char** data,
+		size_t* size) {
+	*data = NULL;
+	*size = 0;
+	if (reserveScoreData(builder, 24) != 0) {
+		return -1;
+	}
+	unsigned char* ptr = builder->data + builder->size;
+	storeLittleFloat(ptr,      0.0);     // start of trailer marker (size of
+	                                     //  trailer is second-to-last # in file)
+	storeLittleInt(ptr + 4,    4000000); // serial number
+	storeLittleFloat(ptr + 8,  4.0);     // program version
+	storeLittleFloat(ptr + 12, 0.0);     // measurement code 0.0=in; 1.0=cm
+	storeLittleFloat(ptr + 16, 5.0);     // previous numbers in trailer (inclusive)
+	storeLittleFloat(ptr + 20, -9999.0); // end of trailer marker
+	builder->size  += 24;
+	builder->count += 6;
+
+	// store the real item count at the start of the data.  Only large
+	// WinScore files use a 4-byte count, since older versions of SCORE
+	// cannot read them.
+	if (builder->count > 0xffff) {
+		storeLittleInt(builder->data, builder->count);
+		builder->start = 0;
+	} else {
+		storeLittleShort(builder->data + 2, builder->count);
+		builder->start = 2;
+	}
+	*data = builder->data + builder->start;
+	*size = builder->size - builder->start;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// freeScoreBuilder -- Free the memory of the builder (and its data).
+//
+
+void freeScoreBuilder(ScoreBuilder* builder) {
+	free(builder->data);
+	memset(builder, 0, sizeof(ScoreBuilder));
+}
+
+
+
+//////////////////////////////
+//
+// reserveScoreData -- Make sure that there is space for at least size
+//    more bytes in the builder.  The buffer size is doubled when it
+//    needs to grow.  Returns -1 and sets builder->error if there is not
+//    enough memory.
+//
+
+static int reserveScoreData(ScoreBuilder* builder, size_t size) {
+	if (builder->size + size <= builder->capacity) {
+		return 0;
+	}
+	if (builder->error) {
+		return -1;
+	}
+	size_t capacity = builder->capacity ? builder->capacity : 4096;
+	while (capacity < builder->size + size) {
+		capacity *= 2;
+	}
+	unsigned char* data = (unsigned char*)realloc(builder->data, capacity);
+	if (data == NULL) {
+		builder->error = 1;
+		return -1;
+	}
+	builder->data     = data;
+	builder->capacity = capacity;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// setScoreError -- Store an error message.  Returns -1 so that it can
+//     be used as a return value.
+//
+
+static int setScoreError(char* error, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	vsnprintf(error, SCORE_ERROR_SIZE, format, args);
+	va_end(args);
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// storeLittleFloat -- Store a four-byte float with smallest byte first.
+//
+
+static void storeLittleFloat(unsigned char* bytes, float value) {
+	union { int i; float f; } data;
+	data.f = value;
+	storeLittleInt(bytes, data.i);
+}
+
+
+
+//////////////////////////////
+//
+// storeLittleInt -- Store a four-byte integer with smallest byte first.
+//
+
+static void storeLittleInt(unsigned char* bytes, int value) {
+	bytes[0] = (unsigned char)(value & 0xff);
+	bytes[1] = (unsigned char)((value >> 8)  & 0xff);
+	bytes[2] = (unsigned char)((value >> 16) & 0xff);
+	bytes[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+
+
+//////////////////////////////
+//
+// storeLittleShort -- Store a two-byte integer with smallest byte first.
+//
+
+static void storeLittleShort(unsigned char* bytes, int value) {
+	bytes[0] = (unsigned char)(value & 0xff);
+	bytes[1] = (unsigned char)((value >> 8) & 0xff);
+}
+
+
+
+//////////////////////////////
+//
+// loadLittleShort -- Read a (two-byte) unsigned short stored in
+//   little-endian ordering.
+//
+
+static int loadLittleShort(const unsigned char* bytes) {
+	return bytes[1] << 8 | bytes[0];
+}
+
+
+
+//////////////////////////////
+//
+// loadLittleInt -- Read a (four-byte) int stored in little-endian
+//   ordering.
+//
+
+static int loadLittleInt(const unsigned char* bytes) {
+	return (int)((uint32_t)bytes[3] << 24 | (uint32_t)bytes[2] << 16 |
+			(uint32_t)bytes[1] << 8 | bytes[0]);
+}
+
+
+
+//////////////////////////////
+//
+// loadLittleFloat -- Read a (four-byte) float stored in little-endian
+//   ordering.
+//
+
+static double loadLittleFloat(const unsigned char* bytes) {
+	union { float f; uint32_t i; } num;
+	num.i = (uint32_t)bytes[3] << 24 | (uint32_t)bytes[2] << 16 |
+			(uint32_t)bytes[1] << 8 | bytes[0];
+	return num.f;
+}
+
+
+
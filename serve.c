@@ -0,0 +1,328 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:12:57 PDT 2026
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026
+// Filename:      serve.c
+// Syntax:        C
+//
+// Description:   Conversion server on a Unix-domain socket (see serve.h
+//                for the protocol).  Each thread of the work pool accepts
+//                connections from the listening socket and handles the
+//                requests of one client at a time.  A client which sends
+//                nothing for SERVE_IDLE_TIMEOUT seconds is disconnected,
+//                so that idle connections do not stall the server.
+//                Errors in a request are sent back to the client, and the
+//                server continues.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "serve.h"
+
+#ifdef _WIN32
+
+int runConversionServer(const char* path, int threadCount,
+		ServeFunction convert) {
+	(void)path;
+	(void)threadCount;
+	(void)convert;
+	fprintf(stderr, "Error: the conversion server is not available on Windows\n");
+	return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "workpool.h"
+
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct {
+	int           listener;
+	ServeFunction convert;
+} Server;
+
+// function declarations:
+static void     serveConnections   (void* context, int index);
+static void     serveClient        (Server* server, int client);
+static int      sendReply          (int client, int status, const char* data,
+                                    size_t size);
+static int      readBytes          (int client, void* buffer, size_t size);
+static int      writeBytes         (int client, const void* buffer,
+                                    size_t size);
+static void     storeLittleInt     (unsigned char* bytes, uint32_t value);
+static void     stopServer         (int number);
+
+// Seconds that a client may wait before sending the next request (or the
+// rest of a request) before its connection is closed, so that idle
+// clients cannot keep all of the threads busy:
+#define SERVE_IDLE_TIMEOUT 10
+
+// Socket filename to remove when the server is stopped:
+static char socketPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+
+
+//////////////////////////////
+//
+// runConversionServer -- Listen for clients on the socket at path, and
+//    convert their requests with threadCount threads.  The server runs
+//    until it is stopped with SIGINT or SIGTERM, which removes the
+//    socket file.  Returns non-zero if the server cannot be started.
+//
+
+int runConversionServer(const char* path, int threadCount,
+		ServeFunction convert) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Error: socket path is too long: %s\n", path);
+		return 1;
+	}
+	strcpy(address.sun_path, path);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		fprintf(stderr, "Error: cannot create socket: %s\n", strerror(errno));
+		return 1;
+	}
+
+	// Remove a socket left over from a previous server, but not one
+	// that is still in use.
+	struct stat info;
+	if ((stat(path, &info) == 0) && S_ISSOCK(info.st_mode)) {
+		if (connect(listener, (struct sockaddr*)&address, sizeof(address)) == 0) {
+			fprintf(stderr, "Error: a server is already running on %s\n", path);
+			close(listener);
+			return 1;
+		}
+		close(listener);
+		unlink(path);
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0) {
+			fprintf(stderr, "Error: cannot create socket: %s\n", strerror(errno));
+			return 1;
+		}
+	}
+
+	if ((bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0) ||
+			(listen(listener, 128) != 0)) {
+		fprintf(stderr, "Error: cannot listen on %s: %s\n", path,
+				strerror(errno));
+		close(listener);
+		return 1;
+	}
+
+	strcpy(socketPath, path);
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT,  stopServer);
+	signal(SIGTERM, stopServer);
+
+	if (threadCount < 1) {
+		threadCount = 1;
+	}
+	Server server;
+	server.listener = listener;
+	server.convert  = convert;
+	// Each job is a thread which accepts clients until the server stops.
+	runWorkPool(threadCount, threadCount, serveConnections, &server);
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// serveConnections -- Accept clients and handle their requests.  Reads
+//    from a client time out after SERVE_IDLE_TIMEOUT seconds.
+//
+
+static void serveConnections(void* context, int index) {
+	Server* server = (Server*)context;
+	struct timeval timeout;
+	timeout.tv_sec  = SERVE_IDLE_TIMEOUT;
+	timeout.tv_usec = 0;
+	(void)index;
+	while (1) {
+		int client = accept(server->listener, NULL, NULL);
+		if (client < 0) {
+			if ((errno == EINTR) || (errno == ECONNABORTED) ||
+					(errno == EMFILE) || (errno == ENFILE)) {
+				if (errno != EINTR) {
+					sleep(1);
+				}
+				continue;
+			}
+			fprintf(stderr, "Error: cannot accept clients: %s\n",
+					strerror(errno));
+			return;
+		}
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		serveClient(server, client);
+		close(client);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// serveClient -- Convert requests from a client until it closes the
+//    connection (or a read times out).  The request buffer is reused for all requests.
+//
+
+static void serveClient(Server* server, int client) {
+	unsigned char* request  = NULL;
+	size_t         capacity = 0;
+	unsigned char  header[4];
+	while (readBytes(client, header, 4) == 0) {
+		uint32_t size = (uint32_t)header[0] | ((uint32_t)header[1] << 8) |
+				((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+		if (size > SERVE_MAX_REQUEST) {
+			const char* message = "Error: request is too large";
+			sendReply(client, 1, message, strlen(message));
+			break;
+		}
+		if (size > capacity) {
+			unsigned char* larger = (unsigned char*)realloc(request, size);
+			if (larger == NULL) {
+				const char* message = "Error: out of memory for request";
+				sendReply(client, 1, message, strlen(message));
+				break;
+			}
+			request  = larger;
+			capacity = size;
+		}
+		if (readBytes(client, request, size) != 0) {
+			break;
+		}
+
+		char*  reply     = NULL;
+		size_t replySize = 0;
+		int    status    = server->convert(request, size, &reply, &replySize);
+		int    sent;
+		if (reply == NULL) {
+			const char* message = "Error: out of memory for reply";
+			sent = sendReply(client, 1, message, strlen(message));
+		} else {
+			sent = sendReply(client, status ? 1 : 0, reply, replySize);
+		}
+		free(reply);
+		if (sent != 0) {
+			break;
+		}
+	}
+	free(request);
+}
+
+
+
+//////////////////////////////
+//
+// sendReply -- Send the reply header and data to the client.  Returns
+//    0 if successful.
+//
+
+static int sendReply(int client, int status, const char* data, size_t size) {
+	unsigned char header[8];
+	storeLittleInt(header, (uint32_t)status);
+	storeLittleInt(header + 4, (uint32_t)size);
+	if (writeBytes(client, header, 8) != 0) {
+		return -1;
+	}
+	return writeBytes(client, data, size);
+}
+
+
+
+//////////////////////////////
+//
+// readBytes -- Read exactly size bytes from the client.  Returns 0 if
+//    successful, or -1 if the connection was closed, failed or timed out.
+//
+
+static int readBytes(int client, void* buffer, size_t size) {
+	unsigned char* ptr = (unsigned char*)buffer;
+	while (size > 0) {
+		ssize_t count = recv(client, ptr, size, 0);
+		if ((count < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (count <= 0) {
+			return -1;
+		}
+		ptr  += count;
+		size -= count;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// writeBytes -- Send exactly size bytes to the client.  Returns 0 if
+//    successful.
+//
+
+static int writeBytes(int client, const void* buffer, size_t size) {
+	const unsigned char* ptr = (const unsigned char*)buffer;
+	while (size > 0) {
+		ssize_t count = send(client, ptr, size, MSG_NOSIGNAL);
+		if ((count < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (count <= 0) {
+			return -1;
+		}
+		ptr  += count;
+		size -= count;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// storeLittleInt -- Store a four-byte integer with smallest byte first.
+//
+
+static void storeLittleInt(unsigned char* bytes, uint32_t value) {
+	bytes[0] = (unsigned char)(value & 0xff);
+	bytes[1] = (unsigned char)((value >> 8)  & 0xff);
+	bytes[2] = (unsigned char)((value >> 16) & 0xff);
+	bytes[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+
+
+//////////////////////////////
+//
+// stopServer -- Signal handler which removes the socket file and ends
+//    the program.
+//
+
+static void stopServer(int number) {
+	(void)number;
+	unlink(socketPath);
+	_exit(0);
+}
+
+#endif  /* _WIN32 */
+
+
+
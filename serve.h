@@ -0,0 +1,41 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:12:57 PDT 2026
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026
+// Filename:      serve.h
+// Syntax:        C
+//
+// Description:   Conversion server on a Unix-domain socket, so that
+//                many files can be converted without starting a new
+//                process for each one.
+//
+//                A client sends requests consisting of the payload
+//                length as a 4-byte little-endian integer, followed by
+//                the payload (a binary SCORE file or PMX text).  For each
+//                request, the server replies with an 8-byte header
+//                containing a 4-byte little-endian status (0 = success,
+//                1 = error) and the 4-byte little-endian length of the
+//                reply data, followed by the data: the converted file,
+//                or the error message.  A connection may be used for any
+//                number of requests, and is closed by the client (or by
+//                the server when the client is idle for 10 seconds).
+//
+
+#ifndef _SERVE_H_INCLUDED
+#define _SERVE_H_INCLUDED
+
+#include <stddef.h>
+
+// Requests with longer payloads are refused:
+#define SERVE_MAX_REQUEST (1 << 30)
+
+// Converts one request.  The reply (the converted data, or an error
+// message) is stored in a buffer allocated with malloc().  Returns 0
+// if successful, or non-zero for an error.
+typedef int (*ServeFunction)(const unsigned char* input, size_t size,
+		char** output, size_t* outputSize);
+
+int      runConversionServer  (const char* path, int threadCount,
+                               ServeFunction convert);
+
+#endif  /* _SERVE_H_INCLUDED */
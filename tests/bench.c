@@ -0,0 +1,643 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:22:18 PDT 2026
+// Last Modified: Thu Oct 15 20:22:18 PDT 2026
+// Last Modified: Thu Oct 15 20:46:35 PDT 2026 added -g option
+// Filename:      bench.c
+// Syntax:        C
+//
+// Description:   End-to-end benchmark of mus2pmx, pmx2mus and drw2aton.
+//                A reproducible corpus is generated into a directory (the
+//                same files for the same size setting), and each program
+//                is timed on each part of the corpus:
+//                   dos:   small DOS pages (2-byte count) with a mix of
+//                          item types modeled on tests/ex1.pmx.
+//                   large: large WinSCORE files (4-byte count).
+//                   text:  pages with mostly text items.
+//                   eps:   pages with many EPS graphic items.
+//                   drw:   DRAW symbol library files for drw2aton.
+//                The best time of several runs is reported as MB/s of
+//                input data and items/s (symbols/s for drw2aton).  The
+//                results can be stored in a baseline file, and later
+//                runs are compared with the baseline.  With -g, only
+//                the corpus is generated (for wasmbench.js).
+//
+// Usage:         bench [-s small|medium|large] [-r runs] [-p programdir]
+//                      [-b baseline [-w] [-t percent]] [-g] corpusdir
+//                   -w: write the baseline file instead of comparing
+//                   -t: slowdown in percent which counts as a regression
+//                       (default 10); the exit status is 1 if there is one
+//                   -g: generate the corpus without running the programs
+//
+// $Smake:        gcc -O2 -o bench bench.c ../libscore.a -lm
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../libscore.h"
+
+// Part of the corpus and the program which is timed on it:
+typedef struct {
+	const char* program;
+	const char* corpus;
+	char*       command;
+	int         files;
+	double      bytes;
+	double      items;
+	double      seconds;
+} BenchTest;
+
+// Relative frequency of item types (P1) in tests/ex1.pmx, and the
+// average number of parameters of each type:
+typedef struct {
+	int P1;
+	int weight;
+	int count;
+} ItemType;
+
+static const ItemType itemTypes[] = {
+	{ 1, 99,  8 }, { 2,  16, 8 }, { 3,  6, 3 }, { 4, 27, 8 }, { 5, 29, 11 },
+	{ 6,  6, 10 }, { 8,   6, 6 }, { 9,  7, 10 }, { 14, 28, 4 }, { 16, 73, 13 },
+	{ 17, 7,  6 }, { 18,  6, 6 }
+};
+
+#define ITEM_TYPE_COUNT (int)(sizeof(itemTypes) / sizeof(itemTypes[0]))
+
+// Words for the text of text items:
+static const char* words[] = {
+	"Allegro", "ma", "non", "troppo", "dolce", "cresc.", "dim.", "Sonata",
+	"I", "II", "Andante", "con", "moto", "rit.", "a", "tempo", "Fine",
+	"D.C.", "al", "Coda", "espressivo", "sempre", "legato", "pizz.", "arco"
+};
+
+#define WORD_COUNT (int)(sizeof(words) / sizeof(words[0]))
+
+// function declarations:
+void     generateCorpus      (const char* dir, int scale, BenchTest* tests,
+                              int* testCount, const char* programs);
+void     generatePages       (const char* dir, const char* name, int files,
+                              int items, int mix, BenchTest* tests,
+                              int* testCount, const char* programs);
+void     addRandomItem       (ScoreBuilder* builder, int mix);
+void     generateDrawFiles   (const char* dir, int files, BenchTest* tests,
+                              int* testCount, const char* programs);
+int      writePageAsPmx      (FILE* output, const unsigned char* data,
+                              size_t size);
+void     writeDataFile       (const char* filename, const void* data,
+                              size_t size);
+char*    appendString        (char* string, const char* text);
+void     makeDirectory       (const char* dir);
+double   getTime             (void);
+uint32_t nextRandom          (void);
+int      randomInt           (int minimum, int maximum);
+void     runTests            (BenchTest* tests, int testCount, int runs);
+int      printResults        (BenchTest* tests, int testCount,
+                              const char* baseline, int writeBaseline,
+                              double threshold);
+
+static uint64_t randomState = 0x9e3779b97f4a7c15ULL;
+
+// Types of pages (the mix parameter of generatePages()):
+#define MIX_NORMAL 0
+#define MIX_TEXT   1
+#define MIX_EPS    2
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	const char* size      = "small";
+	const char* programs  = "..";
+	const char* baseline  = NULL;
+	int         runs      = 3;
+	int         writeQ    = 0;
+	int         generateQ = 0;
+	double      threshold = 10.0;
+	int         opt;
+	while ((opt = getopt(argc, argv, "s:r:p:b:wt:g")) != -1) {
+		switch (opt) {
+			case 's': size = optarg;             break;
+			case 'r': runs = atoi(optarg);       break;
+			case 'p': programs = optarg;         break;
+			case 'b': baseline = optarg;         break;
+			case 'w': writeQ = 1;                break;
+			case 't': threshold = atof(optarg);  break;
+			case 'g': generateQ = 1;             break;
+			default:
+				fprintf(stderr, "Usage: %s [-s small|medium|large] [-r runs] "
+						"[-p programdir] [-b baseline [-w] [-t percent]] "
+						"[-g] corpusdir\n", argv[0]);
+				return 1;
+		}
+	}
+	int scale = 0;
+	if (strcmp(size, "small") == 0) {
+		scale = 1;
+	} else if (strcmp(size, "medium") == 0) {
+		scale = 4;
+	} else if (strcmp(size, "large") == 0) {
+		scale = 16;
+	}
+	if ((scale == 0) || (optind != argc - 1) || (runs < 1)) {
+		fprintf(stderr, "Usage: %s [-s small|medium|large] [-r runs] "
+				"[-p programdir] [-b baseline [-w] [-t percent]] [-g] "
+				"corpusdir\n",
+				argv[0]);
+		return 1;
+	}
+
+	BenchTest tests[16];
+	int       testCount = 0;
+	generateCorpus(argv[optind], scale, tests, &testCount, programs);
+	int regressions = 0;
+	if (!generateQ) {
+		runTests(tests, testCount, runs);
+		regressions = printResults(tests, testCount, baseline, writeQ,
+				threshold);
+	}
+
+	int i;
+	for (i=0; i<testCount; i++) {
+		free(tests[i].command);
+	}
+	return regressions ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// generateCorpus -- Write the benchmark files into dir, and fill in the
+//     list of tests to run on them.
+//
+
+void generateCorpus(const char* dir, int scale, BenchTest* tests,
+		int* testCount, const char* programs) {
+	makeDirectory(dir);
+	generatePages(dir, "dos",   40 * scale, 300,   MIX_NORMAL, tests,
+			testCount, programs);
+	generatePages(dir, "large", 2 * scale,  20000, MIX_NORMAL, tests,
+			testCount, programs);
+	generatePages(dir, "text",  40 * scale, 300,   MIX_TEXT,   tests,
+			testCount, programs);
+	generatePages(dir, "eps",   40 * scale, 300,   MIX_EPS,    tests,
+			testCount, programs);
+	generateDrawFiles(dir, 20 * scale, tests, testCount, programs);
+}
+
+
+
+//////////////////////////////
+//
+// generatePages -- Write binary SCORE files with random items into
+//     dir/name/, and the same pages as one multiple-page PMX file
+//     (dir/name.pmx).  Adds a mus2pmx test for the binary files and a
+//     pmx2mus test for the PMX file.
+//
+
+void generatePages(const char* dir, const char* name, int files, int items,
+		int mix, BenchTest* tests, int* testCount, const char* programs) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	makeDirectory(path);
+	snprintf(path, sizeof(path), "%s/%s.pmx", dir, name);
+	FILE* pmx = fopen(path, "w");
+	if (pmx == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for writing.\n", path);
+		exit(1);
+	}
+
+	BenchTest* mus = &tests[(*testCount)++];
+	BenchTest* asc = &tests[(*testCount)++];
+	memset(mus, 0, sizeof(BenchTest));
+	memset(asc, 0, sizeof(BenchTest));
+	mus->program = "mus2pmx";
+	mus->corpus  = name;
+	mus->files   = files;
+	asc->program = "pmx2mus";
+	asc->corpus  = name;
+	asc->files   = 1;
+	snprintf(path, sizeof(path), "%s/mus2pmx", programs);
+	mus->command = appendString(NULL, path);
+
+	int i, j;
+	for (i=0; i<files; i++) {
+		ScoreBuilder builder;
+		const unsigned char* data;
+		size_t size;
+		initScoreBuilder(&builder, (size_t)items * 64);
+		for (j=0; j<items; j++) {
+			addRandomItem(&builder, mix);
+		}
+		if (finishScoreData(&builder, &data, &size) != 0) {
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+		snprintf(path, sizeof(path), "%s/%s/page%04d.mus", dir, name, i + 1);
+		writeDataFile(path, data, size);
+		mus->command = appendString(mus->command, " ");
+		mus->command = appendString(mus->command, path);
+		mus->bytes  += size;
+		mus->items  += items;
+		if (i > 0) {
+			fprintf(pmx, "##PAGEBREAK\n");
+		}
+		if (writePageAsPmx(pmx, data, size) != 0) {
+			exit(1);
+		}
+		freeScoreBuilder(&builder);
+	}
+	asc->items = mus->items;
+	asc->bytes = ftell(pmx);
+	if (fclose(pmx) != 0) {
+		fprintf(stderr, "Error: cannot write file %s/%s.pmx.\n", dir, name);
+		exit(1);
+	}
+	mus->command = appendString(mus->command, " > /dev/null");
+	snprintf(path, sizeof(path), "%s/pmx2mus %s/%s.pmx /dev/null", programs,
+			dir, name);
+	asc->command = appendString(NULL, path);
+}
+
+
+
+//////////////////////////////
+//
+// addRandomItem -- Add an item of a random type to the builder.  For
+//     MIX_NORMAL the types have the same frequency as in tests/ex1.pmx,
+//     for MIX_TEXT 70% of the items are text items, and for MIX_EPS 40%
+//     of the items are EPS graphic items.
+//
+
+void addRandomItem(ScoreBuilder* builder, int mix) {
+	float param[32];
+	char  text[256];
+	int   textLength = 0;
+	int   i;
+
+	int P1 = 0;
+	if ((mix == MIX_TEXT) && (randomInt(0, 9) < 7)) {
+		P1 = SCORE_TEXT_ITEM;
+	} else if ((mix == MIX_EPS) && (randomInt(0, 9) < 4)) {
+		P1 = SCORE_EPS_ITEM;
+	} else {
+		int total = 0;
+		for (i=0; i<ITEM_TYPE_COUNT; i++) {
+			total += itemTypes[i].weight;
+		}
+		int choice = randomInt(0, total - 1);
+		for (i=0; i<ITEM_TYPE_COUNT; i++) {
+			choice -= itemTypes[i].weight;
+			if (choice < 0) {
+				P1 = itemTypes[i].P1;
+				break;
+			}
+		}
+	}
+
+	int count = 13;
+	for (i=0; i<ITEM_TYPE_COUNT; i++) {
+		if (itemTypes[i].P1 == P1) {
+			count = itemTypes[i].count;
+		}
+	}
+	if ((P1 != SCORE_TEXT_ITEM) && (P1 != SCORE_EPS_ITEM)) {
+		count += randomInt(-2, 2);
+		if (count < 3) {
+			count = 3;
+		}
+	}
+
+	// P2 is the staff number, P3 the horizontal position, and the other
+	// parameters are mostly small numbers in steps of 1/4, with some
+	// values in thousandths.
+	param[0] = (float)P1;
+	param[1] = (float)randomInt(1, 16);
+	param[2] = randomInt(0, 200000) / 1000.0f;
+	for (i=3; i<count; i++) {
+		int kind = randomInt(0, 9);
+		if (kind < 4) {
+			param[i] = 0.0f;
+		} else if (kind < 8) {
+			param[i] = randomInt(-40, 80) / 4.0f;
+		} else {
+			param[i] = randomInt(-200000, 200000) / 1000.0f;
+		}
+	}
+
+	if (P1 == SCORE_TEXT_ITEM) {
+		int wordCount = randomInt(1, mix == MIX_TEXT ? 12 : 3);
+		for (i=0; i<wordCount; i++) {
+			const char* word = words[randomInt(0, WORD_COUNT - 1)];
+			textLength += snprintf(text + textLength, sizeof(text) - textLength,
+					"%s%s", i ? " " : "", word);
+		}
+		param[11] = (float)textLength;
+		param[12] = 0.0f;
+	} else if (P1 == SCORE_EPS_ITEM) {
+		textLength = snprintf(text, sizeof(text), "FIG%04d.EPS",
+				randomInt(1, 9999));
+		param[12] = 0.0f;
+	}
+
+	addScoreItem(builder, param, count, text, textLength);
+}
+
+
+
+//////////////////////////////
+//
+// generateDrawFiles -- Write DRAW symbol library files (as read by
+//     drw2aton) into dir/drw/.  Each file contains 10 symbols with
+//     random vectors.  Adds a drw2aton test for the files.
+//
+
+void generateDrawFiles(const char* dir, int files, BenchTest* tests,
+		int* testCount, const char* programs) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/drw", dir);
+	makeDirectory(path);
+
+	BenchTest* test = &tests[(*testCount)++];
+	memset(test, 0, sizeof(BenchTest));
+	test->program = "drw2aton";
+	test->corpus  = "drw";
+	test->files   = files;
+	snprintf(path, sizeof(path), "%s/drw2aton", programs);
+	test->command = appendString(NULL, path);
+
+	unsigned char data[1 << 16];
+	short         vectors[10000];
+	int           offsets[11];
+	int           i, j, k;
+	for (i=0; i<files; i++) {
+		// Symbol vectors are triples of numbers:
+		int total = 0;
+		for (j=0; j<10; j++) {
+			offsets[j] = total + 1;
+			int triples = randomInt(5, 80);
+			for (k=0; k<3*triples; k++) {
+				vectors[total++] = (short)randomInt(-100, 100);
+			}
+		}
+		offsets[10] = total + 1;
+
+		// header: marker, byte count, offsets, symbol names, byte count
+		int size = 0;
+		data[size++] = 0x4b;
+		data[size++] = 72;
+		for (j=0; j<11; j++) {
+			data[size++] = (unsigned char)(offsets[j] & 0xff);
+			data[size++] = (unsigned char)(offsets[j] >> 8);
+		}
+		for (j=0; j<10; j++) {
+			size += sprintf((char*)data + size, "S%03d ", (i * 10 + j) % 1000);
+		}
+		data[size++] = 72;
+
+		// The vectors are stored in records of up to 127 numbers, which
+		// start and end with an odd byte count.  A zero byte count ends
+		// the data.
+		for (j=0; j<total; j+=127) {
+			int count = total - j < 127 ? total - j : 127;
+			data[size++] = (unsigned char)(2 * count + 1);
+			for (k=0; k<count; k++) {
+				data[size++] = (unsigned char)(vectors[j+k] & 0xff);
+				data[size++] = (unsigned char)((vectors[j+k] >> 8) & 0xff);
+			}
+			data[size++] = (unsigned char)(2 * count + 1);
+		}
+		data[size++] = 0;
+
+		snprintf(path, sizeof(path), "%s/drw/SYM%04d.DRW", dir, i + 1);
+		writeDataFile(path, data, size);
+		test->command = appendString(test->command, " ");
+		test->command = appendString(test->command, path);
+		test->bytes  += size;
+		test->items  += 10;
+	}
+	test->command = appendString(test->command, " > /dev/null");
+}
+
+
+
+//////////////////////////////
+//
+// writePageAsPmx -- Write binary SCORE data as PMX text.  Returns 0 if
+//    successful.
+//
+
+int writePageAsPmx(FILE* output, const unsigned char* data, size_t size) {
+	PmxWriter writer;
+	writer.write   = writePmxToFile;
+	writer.context = output;
+	writer.flags   = 0;
+	if (convertScoreToPmx(&writer, data, size) != 0) {
+		fprintf(stderr, "%s\n", writer.error);
+		return -1;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// runTests -- Run each test command several times, and store the best
+//    time.
+//
+
+void runTests(BenchTest* tests, int testCount, int runs) {
+	int i, j;
+	for (i=0; i<testCount; i++) {
+		for (j=0; j<runs; j++) {
+			double start = getTime();
+			if (system(tests[i].command) != 0) {
+				fprintf(stderr, "Error: %s failed on the %s corpus\n",
+						tests[i].program, tests[i].corpus);
+				exit(1);
+			}
+			double seconds = getTime() - start;
+			if ((j == 0) || (seconds < tests[i].seconds)) {
+				tests[i].seconds = seconds;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// printResults -- Print the speed of each test, and compare it with the
+//    baseline file if given (or write the baseline file).  Returns the
+//    number of tests which are slower than the baseline by more than
+//    threshold percent.
+//
+
+int printResults(BenchTest* tests, int testCount, const char* baseline,
+		int writeBaseline, double threshold) {
+	FILE* base = NULL;
+	if (baseline != NULL) {
+		base = fopen(baseline, writeBaseline ? "w" : "r");
+		if ((base == NULL) && writeBaseline) {
+			fprintf(stderr, "Error: cannot open file %s for writing.\n",
+					baseline);
+			exit(1);
+		}
+	}
+
+	printf("%-9s %-6s %6s %9s %9s %9s %9s %12s %s\n", "program", "corpus",
+			"files", "MB", "items", "seconds", "MB/s", "items/s",
+			base && !writeBaseline ? "  change" : "");
+	int regressions = 0;
+	int i;
+	for (i=0; i<testCount; i++) {
+		BenchTest* test = &tests[i];
+		double seconds = test->seconds > 1e-6 ? test->seconds : 1e-6;
+		double mbps    = test->bytes / 1e6 / seconds;
+		double rate    = test->items / seconds;
+		printf("%-9s %-6s %6d %9.2lf %9.0lf %9.4lf %9.2lf %12.0lf",
+				test->program, test->corpus, test->files, test->bytes / 1e6,
+				test->items, test->seconds, mbps, rate);
+		if ((base != NULL) && writeBaseline) {
+			fprintf(base, "%s\t%s\t%.4lf\t%.1lf\n", test->program, test->corpus,
+					mbps, rate);
+		} else if (base != NULL) {
+			// Find the same test in the baseline:
+			char   program[64];
+			char   corpus[64];
+			double baseMbps;
+			double baseRate;
+			rewind(base);
+			while (fscanf(base, "%63s %63s %lf %lf", program, corpus, &baseMbps,
+					&baseRate) == 4) {
+				if ((strcmp(program, test->program) != 0) ||
+						(strcmp(corpus, test->corpus) != 0)) {
+					continue;
+				}
+				double change = 100.0 * (mbps - baseMbps) / baseMbps;
+				printf(" %+7.1lf%%", change);
+				if (change < -threshold) {
+					printf("  REGRESSION");
+					regressions++;
+				}
+				break;
+			}
+		}
+		printf("\n");
+	}
+
+	if (base != NULL) {
+		if (fclose(base) != 0) {
+			fprintf(stderr, "Error: cannot write file %s.\n", baseline);
+			exit(1);
+		}
+		if (writeBaseline) {
+			printf("Baseline written to %s\n", baseline);
+		}
+	} else if (baseline != NULL) {
+		printf("No baseline in %s (use -w to write one)\n", baseline);
+	}
+	return regressions;
+}
+
+
+
+//////////////////////////////
+//
+// writeDataFile -- Write data to a file, or exit if it cannot be written.
+//
+
+void writeDataFile(const char* filename, const void* data, size_t size) {
+	FILE* output = fopen(filename, "wb");
+	if ((output == NULL) || (fwrite(data, 1, size, output) != size) ||
+			(fclose(output) != 0)) {
+		fprintf(stderr, "Error: cannot write file %s.\n", filename);
+		exit(1);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// appendString -- Append text to a string allocated with malloc(), which
+//     can be NULL to start a new string.  Returns the new string.
+//
+
+char* appendString(char* string, const char* text) {
+	size_t length = string ? strlen(string) : 0;
+	char*  result = (char*)realloc(string, length + strlen(text) + 1);
+	if (result == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+	strcpy(result + length, text);
+	return result;
+}
+
+
+
+//////////////////////////////
+//
+// makeDirectory -- Create a directory if it does not exist.
+//
+
+void makeDirectory(const char* dir) {
+	if ((mkdir(dir, 0777) != 0) && (errno != EEXIST)) {
+		fprintf(stderr, "Error: cannot create directory %s\n", dir);
+		exit(1);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// getTime -- Return the time in seconds from a monotonic clock.
+//
+
+double getTime(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+
+//////////////////////////////
+//
+// nextRandom -- Random number generator (xorshift64*) with a fixed seed,
+//     so that the same corpus is generated each time.
+//
+
+uint32_t nextRandom(void) {
+	randomState ^= randomState >> 12;
+	randomState ^= randomState << 25;
+	randomState ^= randomState >> 27;
+	return (uint32_t)((randomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+
+//////////////////////////////
+//
+// randomInt -- Return a random integer from minimum to maximum
+//     (inclusive).
+//
+
+int randomInt(int minimum, int maximum) {
+	return minimum + (int)(nextRandom() % (uint32_t)(maximum - minimum + 1));
+}
+
+
+
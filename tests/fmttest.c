@@ -0,0 +1,220 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 19:59:16 PDT 2026
+// Last Modified: Thu Oct 15 20:00:52 PDT 2026
+// Filename:      fmttest.c
+// Syntax:        C
+//
+// Description:   Compare the PMX number formatting functions in
+//                pmxformat.c against the printf() formats which they
+//                replace, for float bit patterns in the SCORE value range:
+//                   * formatPmxParameter() against " %8.3lf" of
+//                     roundFractionDigits(), for |value| < 2^21.
+//                   * decodeRoundedParameters() from musdecode.c
+//                     followed by formatPmxMilli(), the same way.
+//                   * formatPmxFloat() against "%1.4lf" and "%2.3lf"
+//                     for P1 values from 0.0 to 100.0.
+//                By default every float bit pattern is tested.  The -s
+//                option tests every n-th bit pattern for a quick check.
+//
+// Usage:         fmttest [-s stride] [-t threads]
+//
+// $Smake:        gcc -O2 -o fmttest fmttest.c ../pmxformat.c ../musdecode.c -lm -lpthread
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../pmxformat.h"
+#include "../musdecode.h"
+
+// function declarations:
+void*    testRange                (void* arg);
+int      checkValue               (float value, int32_t milli);
+double   referenceRound           (double number, int digits);
+
+// Bit pattern of 2^21:
+#define PARAMETER_LIMIT 0x4A000000u
+
+// Number of values passed to decodeRoundedParameters() at once:
+#define BLOCK_SIZE 67
+
+typedef struct {
+	uint32_t start;
+	uint32_t stride;
+	uint32_t step;
+	long     tests;
+	long     errors;
+} TestRange;
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	uint32_t stride  = 1;
+	int      threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int      opt;
+	while ((opt = getopt(argc, argv, "s:t:")) != -1) {
+		if (opt == 's') {
+			stride = (uint32_t)atol(optarg);
+		} else if (opt == 't') {
+			threads = atoi(optarg);
+		} else {
+			fprintf(stderr, "Usage: %s [-s stride] [-t threads]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (stride < 1) {
+		stride = 1;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	pthread_t* thread = (pthread_t*)malloc(threads * sizeof(pthread_t));
+	TestRange* range  = (TestRange*)calloc(threads, sizeof(TestRange));
+	int i;
+	for (i=0; i<threads; i++) {
+		range[i].start  = i * stride;
+		range[i].stride = stride;
+		range[i].step   = threads * stride;
+		pthread_create(&thread[i], NULL, testRange, &range[i]);
+	}
+	long tests  = 0;
+	long errors = 0;
+	for (i=0; i<threads; i++) {
+		pthread_join(thread[i], NULL);
+		tests  += range[i].tests;
+		errors += range[i].errors;
+	}
+	printf("fmttest: %ld values tested, %ld mismatches\n", tests, errors);
+	free(thread);
+	free(range);
+	return errors ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// testRange -- test every step-th bit pattern (with both signs)
+//     starting at the start pattern.  The values are collected into
+//     blocks of little-endian words for decodeRoundedParameters().
+//
+
+void* testRange(void* arg) {
+	TestRange*    range = (TestRange*)arg;
+	unsigned char raw[BLOCK_SIZE * 4];
+	float         value[BLOCK_SIZE];
+	int32_t       milli[BLOCK_SIZE];
+	int           count = 0;
+	int           i;
+	uint64_t      bits;
+	uint64_t      limit = 2 * (uint64_t)PARAMETER_LIMIT;
+	union { float f; uint32_t i; } number;
+	for (bits=range->start; bits<limit; bits+=range->step) {
+		// Alternate between positive and negative values:
+		number.i = (uint32_t)(bits >> 1) | (uint32_t)((bits & 1) << 31);
+		value[count] = number.f;
+		for (i=0; i<4; i++) {
+			raw[4 * count + i] = (unsigned char)(number.i >> (8 * i));
+		}
+		count++;
+		if ((count == BLOCK_SIZE) || (bits + range->step >= limit)) {
+			decodeRoundedParameters(milli, raw, count);
+			for (i=0; i<count; i++) {
+				range->tests++;
+				range->errors += checkValue(value[i], milli[i]);
+			}
+			count = 0;
+		}
+	}
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// checkValue -- Returns the number of formats which do not match
+//     printf() for the given value.  milli is the value as decoded
+//     by decodeRoundedParameters().
+//
+
+int checkValue(float value, int32_t milli) {
+	char expected[PMX_NUMBER_SIZE];
+	char actual[PMX_NUMBER_SIZE];
+	int  length;
+	int  errors = 0;
+
+	snprintf(expected, sizeof(expected), " %8.3lf",
+			referenceRound(value, 3));
+	length = formatPmxParameter(actual, value);
+	actual[length] = '\0';
+	if (strcmp(expected, actual) != 0) {
+		errors++;
+		printf("Mismatch for %.9g: \"%s\" != \"%s\"\n", value, actual,
+				expected);
+	}
+
+	if (milli != MUS_MILLI_INVALID) {
+		length = formatPmxMilli(actual, milli);
+	} else {
+		length = formatPmxParameter(actual, value);
+	}
+	actual[length] = '\0';
+	if (strcmp(expected, actual) != 0) {
+		errors++;
+		printf("Decode mismatch for %.9g: \"%s\" != \"%s\"\n", value,
+				actual, expected);
+	}
+
+	if ((value < 0.0f) || (value >= 100.0f)) {
+		return errors;
+	}
+
+	snprintf(expected, sizeof(expected), "%1.4lf", (double)value);
+	length = formatPmxFloat(actual, value, 1, 4);
+	actual[length] = '\0';
+	if (strcmp(expected, actual) != 0) {
+		errors++;
+		printf("Mismatch for %%1.4lf of %.9g: \"%s\" != \"%s\"\n", value,
+				actual, expected);
+	}
+
+	snprintf(expected, sizeof(expected), "%2.3lf", (double)value);
+	length = formatPmxFloat(actual, value, 2, 3);
+	actual[length] = '\0';
+	if (strcmp(expected, actual) != 0) {
+		errors++;
+		printf("Mismatch for %%2.3lf of %.9g: \"%s\" != \"%s\"\n", value,
+				actual, expected);
+	}
+
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// referenceRound -- The original roundFractionDigits() from mus2pmx.c.
+//
+
+double referenceRound(double number, int digits) {
+	double dshift = pow(10.0, digits);
+	if (number < 0.0) {
+		return ((int)(number * dshift - 0.5))/dshift;
+	} else {
+		return ((int)(number * dshift + 0.5))/dshift;
+	}
+}
+
+
+
@@ -0,0 +1,92 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:18:57 PDT 2026
+// Last Modified: Thu Oct 15 20:18:57 PDT 2026
+// Filename:      libtest.c
+// Syntax:        C
+//
+// Description:   Read the items of a binary SCORE file with the libscore
+//                item iterator, and add them to a ScoreBuilder.  The
+//                rebuilt data must be identical to the input file (which
+//                should be written by pmx2mus, since the trailer is always
+//                written the same way by the builder).
+//
+// Usage:         libtest file.mus
+//
+// $Smake:        gcc -O2 -o libtest libtest.c ../libscore.a -lm
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../libscore.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s file.mus\n", argv[0]);
+		return 1;
+	}
+	size_t size = 0;
+	const unsigned char* input = mapInputFile(argv[1], &size);
+	if (input == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for reading.\n", argv[1]);
+		return 1;
+	}
+
+	ScoreData score;
+	if (openScoreData(&score, input, size) != 0) {
+		fprintf(stderr, "%s\n", score.error);
+		return 1;
+	}
+
+	ScoreBuilder  builder;
+	ScoreIterator iterator;
+	ScoreItem     item;
+	int           status;
+	int           items = 0;
+	float*        parameters = NULL;
+	int           capacity   = 0;
+	initScoreBuilder(&builder, size);
+	beginScoreItems(&iterator, &score);
+	while ((status = nextScoreItem(&iterator, &item)) > 0) {
+		if (item.parameterCount > capacity) {
+			capacity   = item.parameterCount;
+			parameters = (float*)realloc(parameters, capacity * sizeof(float));
+		}
+		getScoreParameters(&item, parameters);
+		if (parameters[0] != getScoreParameter(&item, 1)) {
+			fprintf(stderr, "Error: P1 of item %d does not match\n", items + 1);
+			return 1;
+		}
+		addScoreItem(&builder, parameters, item.parameterCount, item.text,
+				item.textLength);
+		items++;
+	}
+	if (status < 0) {
+		fprintf(stderr, "%s\n", iterator.error);
+		return 1;
+	}
+
+	const unsigned char* output;
+	size_t outputSize;
+	if (finishScoreData(&builder, &output, &outputSize) != 0) {
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	if ((outputSize != size) || (memcmp(output, input, size) != 0)) {
+		fprintf(stderr, "Error: rebuilt data does not match %s\n", argv[1]);
+		return 1;
+	}
+	printf("libtest: %d items rebuilt\n", items);
+
+	free(parameters);
+	freeScoreBuilder(&builder);
+	unmapInputFile(input, size);
+	return 0;
+}
+
+
+
@@ -0,0 +1,511 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:24:20 PDT 2026
+// Last Modified: Thu Oct 15 20:24:20 PDT 2026
+// Filename:      microbench.c
+// Syntax:        C
+//
+// Description:   Micro-benchmark of the number conversion kernels used by
+//                mus2pmx and pmx2mus.  Each kernel is run in a tight loop
+//                over the same block of parameter values, which follow the
+//                distribution of the parameters in tests/ex1.pmx (mostly
+//                zeros, small integers, quarter steps and horizontal
+//                positions with three decimal places):
+//                   decodefloat:  decodeLittleFloats() (binary to float)
+//                   decodemilli:  decodeRoundedParameters() (binary to
+//                                 thousandths, as used by mus2pmx)
+//                   round:        roundFractionDigits(value, 3)
+//                   formatmilli:  formatPmxMilli() (thousandths to text)
+//                   formatparam:  formatPmxParameter() (the " %8.3lf" format)
+//                   printf:       snprintf(" %8.3lf"), for comparison
+//                   parseline:    readAsciiNumberLine() (PMX text to float)
+//                   storefloat:   addScoreItem() (float to binary)
+//                The time of each sample is divided by the number of values
+//                converted, and the mean, standard deviation and median of
+//                the samples are printed in nanoseconds per value.  The
+//                medians can be stored in a baseline file, and later runs
+//                are compared with the baseline.
+//
+// Usage:         microbench [-n samples] [-k kernel]
+//                      [-b baseline [-w] [-t percent]]
+//                   -k: only run kernels with names containing this text
+//                   -w: write the baseline file instead of comparing
+//                   -t: slowdown in percent which counts as a regression
+//                       (default 10); the exit status is 1 if there is one
+//
+// $Smake:        gcc -O2 -o microbench microbench.c ../libscore.a -lm
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../libscore.h"
+#include "../pmxformat.h"
+#include "../musdecode.h"
+#include "../pmxencode.h"
+
+// Number of values converted by each call to a kernel:
+#define VALUE_COUNT 4096
+
+// Minimum time of one sample in seconds:
+#define SAMPLE_TIME 0.002
+
+#define MAX_SAMPLES 1000
+
+typedef struct {
+	const char* name;
+	void      (*run)(void);
+	double      mean;        // ns/value
+	double      deviation;   // ns/value
+	double      median;      // ns/value
+} Kernel;
+
+// function declarations:
+void     prepareValues       (void);
+float    randomParameter     (void);
+void     measureKernel       (Kernel* kernel, int samples);
+int      compareDoubles      (const void* a, const void* b);
+int      printResults        (Kernel* kernels, int kernelCount,
+                              const char* filter, const char* baseline,
+                              int writeBaseline, double threshold);
+double   getTime             (void);
+uint32_t nextRandom          (void);
+void     runDecodeFloat      (void);
+void     runDecodeMilli      (void);
+void     runRound            (void);
+void     runFormatMilli      (void);
+void     runFormatParam      (void);
+void     runPrintf           (void);
+void     runParseLine        (void);
+void     runStoreFloat       (void);
+
+static uint64_t randomState = 0x9e3779b97f4a7c15ULL;
+
+// Input and output data of the kernels:
+static float          values[VALUE_COUNT];
+static double         doubles[VALUE_COUNT];
+static int32_t        millis[VALUE_COUNT];
+static unsigned char  binary[4 * VALUE_COUNT];
+static char*          text;
+static size_t         textLength;
+static float          floats[VALUE_COUNT];
+static int32_t        rounded[VALUE_COUNT];
+static char           output[VALUE_COUNT * PMX_NUMBER_SIZE];
+static Arena          arena;
+static ScoreBuilder   builder;
+
+// Results are added to this so that the kernels are not optimized away:
+static volatile double sink;
+
+static Kernel kernels[] = {
+	{ "decodefloat", runDecodeFloat, 0, 0, 0 },
+	{ "decodemilli", runDecodeMilli, 0, 0, 0 },
+	{ "round",       runRound,       0, 0, 0 },
+	{ "formatmilli", runFormatMilli, 0, 0, 0 },
+	{ "formatparam", runFormatParam, 0, 0, 0 },
+	{ "printf",      runPrintf,      0, 0, 0 },
+	{ "parseline",   runParseLine,   0, 0, 0 },
+	{ "storefloat",  runStoreFloat,  0, 0, 0 }
+};
+
+#define KERNEL_COUNT (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	const char* filter    = NULL;
+	const char* baseline  = NULL;
+	int         samples   = 20;
+	int         writeQ    = 0;
+	double      threshold = 10.0;
+	int         opt;
+	while ((opt = getopt(argc, argv, "n:k:b:wt:")) != -1) {
+		switch (opt) {
+			case 'n': samples = atoi(optarg);    break;
+			case 'k': filter = optarg;           break;
+			case 'b': baseline = optarg;         break;
+			case 'w': writeQ = 1;                break;
+			case 't': threshold = atof(optarg);  break;
+			default:
+				fprintf(stderr, "Usage: %s [-n samples] [-k kernel] "
+						"[-b baseline [-w] [-t percent]]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((samples < 2) || (samples > MAX_SAMPLES)) {
+		fprintf(stderr, "Error: number of samples must be from 2 to %d\n",
+				MAX_SAMPLES);
+		return 1;
+	}
+
+	prepareValues();
+	initArena(&arena, 4096);
+	initScoreBuilder(&builder, 4 * (VALUE_COUNT + VALUE_COUNT / 8));
+
+	int i;
+	for (i=0; i<KERNEL_COUNT; i++) {
+		if ((filter == NULL) || (strstr(kernels[i].name, filter) != NULL)) {
+			measureKernel(&kernels[i], samples);
+		}
+	}
+	int regressions = printResults(kernels, KERNEL_COUNT, filter, baseline,
+			writeQ, threshold);
+
+	freeScoreBuilder(&builder);
+	freeArena(&arena);
+	free(text);
+	return regressions ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+
+
+//////////////////////////////
+//
+// prepareValues -- Generate the parameter values, and store them in the
+//     input formats of the kernels: as floats, doubles, thousandths,
+//     binary SCORE data and a line of PMX text.
+//
+
+void prepareValues(void) {
+	char number[PMX_NUMBER_SIZE];
+	text = (char*)malloc(VALUE_COUNT * PMX_NUMBER_SIZE);
+	if (text == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+	textLength = 0;
+	int i;
+	for (i=0; i<VALUE_COUNT; i++) {
+		values[i]  = randomParameter();
+		doubles[i] = values[i];
+		millis[i]  = (int32_t)lround(values[i] * 1000.0);
+		uint32_t bits;
+		memcpy(&bits, &values[i], 4);
+		binary[4*i]     = (unsigned char)bits;
+		binary[4*i + 1] = (unsigned char)(bits >> 8);
+		binary[4*i + 2] = (unsigned char)(bits >> 16);
+		binary[4*i + 3] = (unsigned char)(bits >> 24);
+		int length = formatPmxParameter(number, values[i]);
+		memcpy(text + textLength, number, length);
+		textLength += length;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// randomParameter -- Return a random SCORE parameter value.  The
+//     proportions of the kinds of values are about the same as in the
+//     parameters of tests/ex1.pmx.
+//
+
+float randomParameter(void) {
+	uint32_t kind = nextRandom() % 100;
+	if (kind < 35) {
+		return 0.0f;
+	} else if (kind < 60) {
+		return (float)(1 + nextRandom() % 20);
+	} else if (kind < 80) {
+		return (float)((int)(nextRandom() % 161) - 40) / 4.0f;
+	} else if (kind < 95) {
+		return (float)(nextRandom() % 200000) / 1000.0f;
+	} else {
+		return (float)(100 + nextRandom() % 9900);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// measureKernel -- Run a kernel for the given number of samples.  The
+//     kernel is repeated enough times in each sample to take at least
+//     SAMPLE_TIME seconds.
+//
+
+void measureKernel(Kernel* kernel, int samples) {
+	// Warm up the caches and find the number of repetitions per sample:
+	int repeat = 1;
+	while (1) {
+		double start = getTime();
+		int i;
+		for (i=0; i<repeat; i++) {
+			kernel->run();
+		}
+		if ((getTime() - start >= SAMPLE_TIME) || (repeat >= (1 << 24))) {
+			break;
+		}
+		repeat *= 2;
+	}
+
+	double times[MAX_SAMPLES];
+	double sum = 0.0;
+	int s;
+	for (s=0; s<samples; s++) {
+		double start = getTime();
+		int i;
+		for (i=0; i<repeat; i++) {
+			kernel->run();
+		}
+		times[s] = (getTime() - start) * 1e9 / ((double)repeat * VALUE_COUNT);
+		sum += times[s];
+	}
+
+	kernel->mean = sum / samples;
+	double variance = 0.0;
+	for (s=0; s<samples; s++) {
+		variance += (times[s] - kernel->mean) * (times[s] - kernel->mean);
+	}
+	kernel->deviation = sqrt(variance / (samples - 1));
+	qsort(times, samples, sizeof(double), compareDoubles);
+	kernel->median = (samples % 2) ? times[samples / 2] :
+			(times[samples / 2 - 1] + times[samples / 2]) / 2.0;
+}
+
+
+
+//////////////////////////////
+//
+// compareDoubles -- Sort function for qsort().
+//
+
+int compareDoubles(const void* a, const void* b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+
+
+//////////////////////////////
+//
+// printResults -- Print the time of each kernel, and either write the
+//     medians to the baseline file, or compare them with the baseline.
+//     Returns the number of kernels which are slower than the baseline
+//     by more than the threshold percentage.
+//
+
+int printResults(Kernel* kernels, int kernelCount, const char* filter,
+		const char* baseline, int writeBaseline, double threshold) {
+	FILE* base = NULL;
+	if (baseline != NULL) {
+		base = fopen(baseline, writeBaseline ? "w" : "r");
+		if ((base == NULL) && writeBaseline) {
+			fprintf(stderr, "Error: cannot open file %s for writing.\n",
+					baseline);
+			exit(1);
+		}
+	}
+
+	printf("%-12s %9s %9s %7s %9s%s\n", "kernel", "ns/value", "stddev",
+			"", "median", base && !writeBaseline ? "    change" : "");
+	int regressions = 0;
+	int i;
+	for (i=0; i<kernelCount; i++) {
+		Kernel* kernel = &kernels[i];
+		if ((filter != NULL) && (strstr(kernel->name, filter) == NULL)) {
+			continue;
+		}
+		printf("%-12s %9.3lf %9.3lf %6.1lf%% %9.3lf", kernel->name,
+				kernel->mean, kernel->deviation,
+				100.0 * kernel->deviation / kernel->mean, kernel->median);
+		if ((base != NULL) && writeBaseline) {
+			fprintf(base, "%s\t%.4lf\n", kernel->name, kernel->median);
+		} else if (base != NULL) {
+			// Find the same kernel in the baseline:
+			char   name[64];
+			double baseMedian;
+			rewind(base);
+			while (fscanf(base, "%63s %lf", name, &baseMedian) == 2) {
+				if (strcmp(name, kernel->name) != 0) {
+					continue;
+				}
+				double change = 100.0 * (kernel->median - baseMedian) /
+						baseMedian;
+				printf(" %+8.1lf%%", change);
+				if (change > threshold) {
+					printf("  REGRESSION");
+					regressions++;
+				}
+				break;
+			}
+		}
+		printf("\n");
+	}
+
+	if (base != NULL) {
+		if (fclose(base) != 0) {
+			fprintf(stderr, "Error: cannot write file %s.\n", baseline);
+			exit(1);
+		}
+		if (writeBaseline) {
+			printf("Baseline written to %s\n", baseline);
+		}
+	} else if (baseline != NULL) {
+		printf("No baseline in %s (use -w to write one)\n", baseline);
+	}
+	return regressions;
+}
+
+
+
+//////////////////////////////
+//
+// getTime -- Return the time in seconds from a monotonic clock.
+//
+
+double getTime(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+
+//////////////////////////////
+//
+// nextRandom -- Random number generator (xorshift64*) with a fixed seed,
+//     so that the same values are used each time.
+//
+
+uint32_t nextRandom(void) {
+	randomState ^= randomState >> 12;
+	randomState ^= randomState << 25;
+	randomState ^= randomState >> 27;
+	return (uint32_t)((randomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+
+//////////////////////////////
+//
+// runDecodeFloat -- Convert little-endian binary data into floats.
+//
+
+void runDecodeFloat(void) {
+	decodeLittleFloats(floats, binary, VALUE_COUNT);
+	sink += floats[VALUE_COUNT - 1];
+}
+
+
+
+//////////////////////////////
+//
+// runDecodeMilli -- Convert little-endian binary data into thousandths
+//     (the rounding done by mus2pmx before formatting).
+//
+
+void runDecodeMilli(void) {
+	sink += decodeRoundedParameters(rounded, binary, VALUE_COUNT);
+	sink += rounded[VALUE_COUNT - 1];
+}
+
+
+
+//////////////////////////////
+//
+// runRound -- Round values to three decimal places.
+//
+
+void runRound(void) {
+	double sum = 0.0;
+	int i;
+	for (i=0; i<VALUE_COUNT; i++) {
+		sum += roundFractionDigits(doubles[i], 3);
+	}
+	sink += sum;
+}
+
+
+
+//////////////////////////////
+//
+// runFormatMilli -- Print thousandths as PMX numbers.
+//
+
+void runFormatMilli(void) {
+	size_t length = 0;
+	int i;
+	for (i=0; i<VALUE_COUNT; i++) {
+		length += formatPmxMilli(output + length, millis[i]);
+	}
+	sink += length;
+}
+
+
+
+//////////////////////////////
+//
+// runFormatParam -- Print values as PMX numbers.
+//
+
+void runFormatParam(void) {
+	size_t length = 0;
+	int i;
+	for (i=0; i<VALUE_COUNT; i++) {
+		length += formatPmxParameter(output + length, doubles[i]);
+	}
+	sink += length;
+}
+
+
+
+//////////////////////////////
+//
+// runPrintf -- Print values with the printf() format which is replaced
+//     by formatPmxParameter().
+//
+
+void runPrintf(void) {
+	size_t length = 0;
+	int i;
+	for (i=0; i<VALUE_COUNT; i++) {
+		length += snprintf(output + length, PMX_NUMBER_SIZE, " %8.3lf",
+				roundFractionDigits(doubles[i], 3));
+	}
+	sink += length;
+}
+
+
+
+//////////////////////////////
+//
+// runParseLine -- Read the numbers of a line of PMX text.
+//
+
+void runParseLine(void) {
+	int count = readAsciiNumberLine(floats, 0, text, text + textLength,
+			&arena);
+	resetArena(&arena);
+	sink += count + floats[VALUE_COUNT - 1];
+}
+
+
+
+//////////////////////////////
+//
+// runStoreFloat -- Store the values as binary SCORE items of eight
+//     parameters each.
+//
+
+void runStoreFloat(void) {
+	// Start again after the space for the count field:
+	builder.size  = 4;
+	builder.count = 0;
+	int i;
+	for (i=0; i<VALUE_COUNT; i+=8) {
+		addScoreItem(&builder, values + i, 8, NULL, 0);
+	}
+	sink += builder.data[builder.size - 1];
+}
+
+
+
@@ -0,0 +1,253 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:12:57 PDT 2026
+// Last Modified: Thu Oct 15 20:12:57 PDT 2026
+// Filename:      servetest.c
+// Syntax:        C
+//
+// Description:   Test client for the conversion server (mus2pmx --serve).
+//                Each input file is sent to the server, and the reply is
+//                compared with the expected output file.  Several
+//                threads send the requests at the same time, each on its
+//                own connection.  A request which is not a valid SCORE
+//                file is also sent to check that an error is returned
+//                and the connection stays usable.
+//
+// Usage:         servetest [-t threads] [-n repeat] socket input expected
+//                   [input expected ...]
+//
+// $Smake:        gcc -O2 -o servetest servetest.c -lpthread
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// function declarations:
+void*          runClient      (void* arg);
+int            request        (int fd, const unsigned char* data,
+                               size_t size, unsigned char** reply,
+                               size_t* replySize);
+unsigned char* readFile       (const char* filename, size_t* size);
+int            readBytes      (int fd, void* buffer, size_t size);
+int            writeBytes     (int fd, const void* buffer, size_t size);
+
+typedef struct {
+	unsigned char* data;
+	size_t         size;
+} Buffer;
+
+const char* socketPath = NULL;
+Buffer*     inputs     = NULL;
+Buffer*     expected   = NULL;
+int         fileCount  = 0;
+int         repeat     = 100;
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	int threads = 4;
+	int opt;
+	while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+		if (opt == 't') {
+			threads = atoi(optarg);
+		} else if (opt == 'n') {
+			repeat = atoi(optarg);
+		} else {
+			optind = argc;
+			break;
+		}
+	}
+	if ((argc - optind < 3) || ((argc - optind) % 2 != 1) || (threads < 1)) {
+		fprintf(stderr, "Usage: %s [-t threads] [-n repeat] socket input "
+				"expected [input expected ...]\n", argv[0]);
+		return 1;
+	}
+	socketPath = argv[optind];
+	fileCount  = (argc - optind - 1) / 2;
+	inputs     = (Buffer*)malloc(fileCount * sizeof(Buffer));
+	expected   = (Buffer*)malloc(fileCount * sizeof(Buffer));
+	int i;
+	for (i=0; i<fileCount; i++) {
+		inputs[i].data   = readFile(argv[optind + 1 + 2 * i], &inputs[i].size);
+		expected[i].data = readFile(argv[optind + 2 + 2 * i], &expected[i].size);
+	}
+
+	pthread_t* thread = (pthread_t*)malloc(threads * sizeof(pthread_t));
+	long*      errors = (long*)calloc(threads, sizeof(long));
+	for (i=0; i<threads; i++) {
+		pthread_create(&thread[i], NULL, runClient, &errors[i]);
+	}
+	long total = 0;
+	for (i=0; i<threads; i++) {
+		pthread_join(thread[i], NULL);
+		total += errors[i];
+	}
+	printf("servetest: %ld requests, %ld errors\n",
+			(long)threads * repeat * (fileCount + 1), total);
+	return total ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// runClient -- Send all of the test requests repeat times on one
+//     connection.
+//
+
+void* runClient(void* arg) {
+	long* errors = (long*)arg;
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((fd < 0) || (connect(fd, (struct sockaddr*)&address,
+			sizeof(address)) != 0)) {
+		printf("Error: cannot connect to %s\n", socketPath);
+		(*errors)++;
+		return NULL;
+	}
+
+	// Ends with -9999.0, but is too short to be a SCORE file:
+	static const unsigned char bad[8] = { 1, 2, 3, 4, 0x00, 0x3c, 0x1c, 0xc6 };
+	unsigned char* reply;
+	size_t         size;
+	int            status;
+	int            i, j;
+	for (i=0; i<repeat; i++) {
+		for (j=0; j<fileCount; j++) {
+			status = request(fd, inputs[j].data, inputs[j].size, &reply, &size);
+			if (status < 0) {
+				printf("Error: connection failed\n");
+				(*errors)++;
+				close(fd);
+				return NULL;
+			}
+			if ((status != 0) || (size != expected[j].size) ||
+					(memcmp(reply, expected[j].data, size) != 0)) {
+				printf("Error: unexpected reply for input %d\n", j + 1);
+				(*errors)++;
+			}
+			free(reply);
+		}
+		status = request(fd, bad, sizeof(bad), &reply, &size);
+		if (status != 1) {
+			printf("Error: no error reported for invalid input\n");
+			(*errors)++;
+		}
+		free(reply);
+	}
+	close(fd);
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// request -- Send a request and read the reply.  Returns the status
+//     of the reply, or -1 if the connection failed.
+//
+
+int request(int fd, const unsigned char* data, size_t size,
+		unsigned char** reply, size_t* replySize) {
+	unsigned char header[8];
+	int i;
+	for (i=0; i<4; i++) {
+		header[i] = (unsigned char)(size >> (8 * i));
+	}
+	*reply = NULL;
+	if ((writeBytes(fd, header, 4) != 0) || (writeBytes(fd, data, size) != 0) ||
+			(readBytes(fd, header, 8) != 0)) {
+		return -1;
+	}
+	uint32_t status = 0;
+	uint32_t length = 0;
+	for (i=3; i>=0; i--) {
+		status = (status << 8) | header[i];
+		length = (length << 8) | header[4 + i];
+	}
+	*reply     = (unsigned char*)malloc(length + 1);
+	*replySize = length;
+	if (readBytes(fd, *reply, length) != 0) {
+		return -1;
+	}
+	return (int)status;
+}
+
+
+
+//////////////////////////////
+//
+// readFile -- Read the contents of a file into memory.
+//
+
+unsigned char* readFile(const char* filename, size_t* size) {
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Error: cannot read %s\n", filename);
+		exit(1);
+	}
+	fseek(file, 0, SEEK_END);
+	*size = (size_t)ftell(file);
+	rewind(file);
+	unsigned char* data = (unsigned char*)malloc(*size + 1);
+	if (fread(data, 1, *size, file) != *size) {
+		fprintf(stderr, "Error: cannot read %s\n", filename);
+		exit(1);
+	}
+	fclose(file);
+	return data;
+}
+
+
+
+//////////////////////////////
+//
+// readBytes -- Read exactly size bytes.  Returns 0 if successful.
+//
+
+int readBytes(int fd, void* buffer, size_t size) {
+	unsigned char* ptr = (unsigned char*)buffer;
+	while (size > 0) {
+		ssize_t count = read(fd, ptr, size);
+		if (count <= 0) {
+			return -1;
+		}
+		ptr  += count;
+		size -= count;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// writeBytes -- Write exactly size bytes.  Returns 0 if successful.
+//
+
+int writeBytes(int fd, const void* buffer, size_t size) {
+	const unsigned char* ptr = (const unsigned char*)buffer;
+	while (size > 0) {
+		ssize_t count = write(fd, ptr, size);
+		if (count <= 0) {
+			return -1;
+		}
+		ptr  += count;
+		size -= count;
+	}
+	return 0;
+}
+
+
+
@@ -0,0 +1,179 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:46:35 PDT 2026
+// Last Modified: Thu Oct 15 20:46:35 PDT 2026
+// Filename:      wasmbench.js
+// Syntax:        JavaScript; Node.js
+//
+// Description:   Benchmark of the two WebAssembly builds of mus2pmx
+//                (mus2pmx.wasm, and mus2pmx-simd.js with SIMD128 and
+//                threads, see ../docs/Makefile) on the MUS files of a
+//                corpus generated by "bench -g".  Each build converts the
+//                files one at a time with convertMusToPmx() and all at
+//                once with convertMusFilesToPmx(), and the best time of
+//                several rounds is reported as files/s and MB/s of input
+//                data.  The output of the two builds must be the same.
+//                The SIMD build is skipped if Node.js does not support
+//                it.
+//
+// Usage:         node wasmbench.js mus2pmx.wasm mus2pmx-simd.js corpusdir
+//                     [rounds]
+//
+
+"use strict";
+
+const fs = require("fs");
+const path = require("path");
+const { performance } = require("perf_hooks");
+const { loadMus2pmx, hasWasmSimd, hasWasmThreads } =
+		require("../docs/mus2pmx-loader.js");
+
+
+//////////////////////////////
+//
+// readCorpus -- Return the MUS files in the subdirectories of dir,
+//    sorted by name.
+//
+
+function readCorpus(dir) {
+	const files = [];
+	for (const subdir of fs.readdirSync(dir).sort()) {
+		const subpath = path.join(dir, subdir);
+		if (!fs.statSync(subpath).isDirectory()) {
+			continue;
+		}
+		for (const name of fs.readdirSync(subpath).sort()) {
+			if (name.endsWith(".mus")) {
+				files.push(fs.readFileSync(path.join(subpath, name)));
+			}
+		}
+	}
+	return files;
+}
+
+
+//////////////////////////////
+//
+// copyCorpus -- Copy the files into one allocation of wasm memory,
+//    followed by the (offset, length) records for convertMusFilesToPmx().
+//
+
+function copyCorpus(exports, files) {
+	const size = files.reduce((sum, bytes) => sum + bytes.length, 0);
+	const recordsAt = (size + 3) & ~3;
+	const ptr = exports.malloc(recordsAt + 8 * files.length);
+	if (!ptr) {
+		throw new Error("malloc failed for " + size + " bytes");
+	}
+	const records = new Uint32Array(2 * files.length);
+	let offset = 0;
+	files.forEach((bytes, i) => {
+		new Uint8Array(exports.memory.buffer).set(bytes, ptr + offset);
+		records[2 * i] = offset;
+		records[2 * i + 1] = bytes.length;
+		offset += bytes.length;
+	});
+	new Uint8Array(exports.memory.buffer).set(new Uint8Array(records.buffer),
+			ptr + recordsAt);
+	return { ptr, size, records, recordsAt };
+}
+
+
+//////////////////////////////
+//
+// timeBest -- Return the shortest time in seconds of several calls.
+//
+
+function timeBest(rounds, run) {
+	let best = Infinity;
+	for (let i = 0; i < rounds; i++) {
+		const start = performance.now();
+		run();
+		best = Math.min(best, (performance.now() - start) / 1000);
+	}
+	return best;
+}
+
+
+//////////////////////////////
+//
+// benchmarkBuild -- Time a build on the corpus, print the results, and
+//    return the output text of the batch conversion.
+//
+
+function benchmarkBuild(exports, files, rounds) {
+	const corpus = copyCorpus(exports, files);
+	const single = timeBest(rounds, () => {
+		for (let i = 0; i < files.length; i++) {
+			exports.convertMusToPmx(corpus.ptr + corpus.records[2 * i],
+					corpus.records[2 * i + 1]);
+		}
+	});
+	const batch = timeBest(rounds, () => {
+		exports.convertMusFilesToPmx(corpus.ptr, corpus.size,
+				corpus.ptr + corpus.recordsAt, 0, files.length);
+	});
+	const start = exports.getPmxOutput();
+	const output = new Uint8Array(exports.memory.buffer, start,
+			exports.getPmxOutputLength()).slice();
+	exports.free(corpus.ptr);
+
+	for (const [mode, seconds] of [["single", single], ["batch", batch]]) {
+		console.log(exports.build.padEnd(7) + mode.padEnd(7) +
+				String(files.length).padStart(6) +
+				(corpus.size / 1e6).toFixed(2).padStart(9) +
+				seconds.toFixed(4).padStart(9) +
+				(files.length / seconds).toFixed(0).padStart(10) +
+				(corpus.size / 1e6 / seconds).toFixed(2).padStart(9));
+	}
+	return output;
+}
+
+
+//////////////////////////////
+//
+// main --
+//
+
+async function main() {
+	const [wasmFile, simdFile, corpusDir, roundsArg] = process.argv.slice(2);
+	if (!corpusDir) {
+		console.error("Usage: node wasmbench.js mus2pmx.wasm mus2pmx-simd.js " +
+				"corpusdir [rounds]");
+		process.exit(1);
+	}
+	const rounds = Math.max(1, parseInt(roundsArg || "5"));
+	const files = readCorpus(corpusDir);
+	if (files.length === 0) {
+		console.error("Error: no MUS files in " + corpusDir);
+		process.exit(1);
+	}
+	const wasm = fs.readFileSync(wasmFile);
+	const createSimd = require(path.resolve(simdFile));
+
+	console.log("SIMD128: " + (hasWasmSimd() ? "yes" : "no") +
+			", threads: " + (hasWasmThreads() ? "yes" : "no"));
+	console.log("build  mode    files       MB  seconds   files/s     MB/s");
+	const scalar = await loadMus2pmx({ wasm, build: "scalar" });
+	const scalarOutput = benchmarkBuild(scalar, files, rounds);
+
+	let simd;
+	try {
+		simd = await loadMus2pmx({ wasm, createSimd, build: "simd" });
+	} catch (err) {
+		console.log("simd   skipped: " + err.message);
+		process.exit(0);
+	}
+	const simdOutput = benchmarkBuild(simd, files, rounds);
+	if (Buffer.compare(Buffer.from(scalarOutput), Buffer.from(simdOutput)) !== 0) {
+		console.log("Error: the output of the builds is different");
+		process.exit(1);
+	}
+	// The Emscripten workers of the SIMD build keep Node.js running.
+	process.exit(0);
+}
+
+main().catch(err => {
+	console.error(err);
+	process.exit(1);
+});
@@ -0,0 +1,175 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:42:14 PDT 2026
+// Last Modified: Thu Oct 15 20:42:14 PDT 2026
+// Last Modified: Thu Oct 15 20:49:19 PDT 2026 check chunked conversion
+// Filename:      wasmtest.js
+// Syntax:        JavaScript; Node.js
+//
+// Description:   Round trip of PMX files through the WebAssembly versions
+//                of pmx2mus and mus2pmx (compiled in ../docs with emcc).
+//                Each PMX file is converted with pmx2mus.wasm, which must
+//                give the same bytes as the command-line pmx2mus, and the
+//                result is converted back with mus2pmx.wasm, which must
+//                give the same text as the command-line mus2pmx.  The
+//                conversion in chunks (beginConversion() and nextChunk())
+//                must give the same text as well, in chunks of complete
+//                lines.
+//
+// Usage:         node wasmtest.js mus2pmx.wasm pmx2mus.wasm file.pmx ...
+//
+
+"use strict";
+
+const fs = require("fs");
+const path = require("path");
+const { execFileSync } = require("child_process");
+
+const PMX2MUS = path.join(__dirname, "..", "pmx2mus");
+const MUS2PMX = path.join(__dirname, "..", "mus2pmx");
+
+
+//////////////////////////////
+//
+// loadWasm -- Instantiate a wasm file and return its exports.  Imported
+//    functions (such as WASI calls which the conversions do not use) are
+//    given empty implementations.
+//
+
+async function loadWasm(filename) {
+	const module = await WebAssembly.compile(fs.readFileSync(filename));
+	const imports = {};
+	for (const entry of WebAssembly.Module.imports(module)) {
+		if (entry.kind === "function") {
+			imports[entry.module] = imports[entry.module] || {};
+			imports[entry.module][entry.name] = () => 0;
+		}
+	}
+	const instance = await WebAssembly.instantiate(module, imports);
+	if (instance.exports._initialize) {
+		instance.exports._initialize();
+	}
+	return instance.exports;
+}
+
+
+//////////////////////////////
+//
+// convertInput -- Copy the input bytes into the wasm memory, call the
+//    conversion function, and return a copy of the output bytes.
+//
+
+function convertInput(exports, bytes, convert) {
+	const ptr = exports.malloc(bytes.length);
+	if (!ptr) {
+		throw new Error("malloc failed for " + bytes.length + " bytes");
+	}
+	new Uint8Array(exports.memory.buffer).set(bytes, ptr);
+	const [start, length] = convert(ptr, bytes.length);
+	// Create the view after the conversion, which may grow the memory:
+	const output = new Uint8Array(exports.memory.buffer, start, length).slice();
+	exports.free(ptr);
+	return output;
+}
+
+
+//////////////////////////////
+//
+// pmxToMus -- Convert PMX text with pmx2mus.wasm.
+//
+
+function pmxToMus(exports, text) {
+	return convertInput(exports, text, (ptr, length) => {
+		const start = exports.convertPmxToMus(ptr, length);
+		return [start, exports.getMusOutputLength()];
+	});
+}
+
+
+//////////////////////////////
+//
+// musToPmx -- Convert binary SCORE data with mus2pmx.wasm.
+//
+
+function musToPmx(exports, data) {
+	return convertInput(exports, data, (ptr, length) => {
+		exports.convertMusToPmx(ptr, length);
+		return [exports.getPmxOutput(), exports.getPmxOutputLength()];
+	});
+}
+
+
+//////////////////////////////
+//
+// musToPmxChunks -- Convert binary SCORE data with mus2pmx.wasm in chunks
+//    of at most maxBytes, and return the text of the chunks, or null if a
+//    chunk does not end at the end of a line or is too long.
+//
+
+function musToPmxChunks(exports, data, maxBytes) {
+	const ptr = exports.malloc(data.length);
+	if (!ptr) {
+		throw new Error("malloc failed for " + data.length + " bytes");
+	}
+	new Uint8Array(exports.memory.buffer).set(data, ptr);
+	exports.beginConversion(ptr, data.length);
+	const chunks = [];
+	let valid = true;
+	let chunk;
+	while ((chunk = exports.nextChunk(maxBytes)) !== 0) {
+		const text = new Uint8Array(exports.memory.buffer, chunk,
+				exports.getPmxOutputLength()).slice();
+		const newline = text.indexOf(10);
+		if ((text.length === 0) || (text[text.length - 1] !== 10) ||
+				((text.length > maxBytes) && (newline !== text.length - 1))) {
+			valid = false;
+		}
+		chunks.push(Buffer.from(text));
+	}
+	exports.free(ptr);
+	return valid ? Buffer.concat(chunks) : null;
+}
+
+
+//////////////////////////////
+//
+// main --
+//
+
+async function main() {
+	const [mus2pmxFile, pmx2musFile, ...files] = process.argv.slice(2);
+	if (!pmx2musFile || files.length === 0) {
+		console.error("Usage: node wasmtest.js mus2pmx.wasm pmx2mus.wasm file.pmx ...");
+		process.exit(1);
+	}
+	const mus2pmx = await loadWasm(mus2pmxFile);
+	const pmx2mus = await loadWasm(pmx2musFile);
+
+	let failures = 0;
+	for (const file of files) {
+		const mus = pmxToMus(pmx2mus, fs.readFileSync(file));
+		const nativeMus = execFileSync(PMX2MUS, [file, "-"]);
+		const pmx = musToPmx(mus2pmx, mus);
+		const nativePmx = execFileSync(MUS2PMX, ["-"], { input: nativeMus });
+		const chunks = musToPmxChunks(mus2pmx, mus, 1000);
+		if (Buffer.compare(Buffer.from(mus), nativeMus) !== 0) {
+			console.log(file + ": pmx2mus.wasm output differs from pmx2mus");
+			failures++;
+		} else if (Buffer.compare(Buffer.from(pmx), nativePmx) !== 0) {
+			console.log(file + ": mus2pmx.wasm output differs from mus2pmx");
+			failures++;
+		} else if (!chunks || (Buffer.compare(chunks, nativePmx) !== 0)) {
+			console.log(file + ": mus2pmx.wasm chunks differ from mus2pmx");
+			failures++;
+		} else {
+			console.log(file + ": " + mus.length + " bytes, " + pmx.length +
+					" characters, same as the command-line programs");
+		}
+	}
+	process.exit(failures ? 1 : 0);
+}
+
+main().catch(err => {
+	console.error(err);
+	process.exit(1);
+});
@@ -0,0 +1,222 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:29:08 PDT 2026
+// Last Modified: Thu Oct 15 20:29:08 PDT 2026
+// Filename:      trace.c
+// Syntax:        C
+//
+// Description:   Timeline of a conversion run for the --trace option (see
+//                trace.h).  The spans are stored in memory while the files
+//                are converted, and written as JSON at the end of the run.
+//                Times are in seconds from CLOCK_MONOTONIC (the same clock
+//                as getStatsTime() in runstats.c).  Each thread which adds
+//                a span is given a small number as its thread id.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+typedef struct {
+	const char* name;
+	char*       file;
+	double      start;
+	double      end;
+	int         thread;
+} TraceSpan;
+
+typedef struct {
+	const char*     program;
+	double          start;
+	TraceSpan*      spans;
+	int             count;
+	int             capacity;
+	int             threads;
+	pthread_mutex_t mutex;
+} TraceLog;
+
+static TraceLog* traceLog = NULL;
+
+// Thread id of the current thread in the timeline (0 if not given yet):
+static __thread int traceThread = 0;
+
+// function declarations:
+
+
+
+//////////////////////////////
+//
+// startTrace -- Start recording spans.  isTracing() returns true
+//     afterwards.
+//
+
+void startTrace(const char* program) {
+	traceLog = (TraceLog*)calloc(1, sizeof(TraceLog));
+	if (traceLog == NULL) {
+		fprintf(stderr, "Error: out of memory for trace\n");
+		exit(1);
+	}
+	traceLog->program = program;
+	traceLog->start   = getTraceTime();
+	pthread_mutex_init(&traceLog->mutex, NULL);
+}
+
+
+
+//////////////////////////////
+//
+// isTracing -- Returns true if spans are being recorded.
+//
+
+int isTracing(void) {
+	return traceLog != NULL;
+}
+
+
+
+//////////////////////////////
+//
+// getTraceTime -- Return the time in seconds from a monotonic clock.
+//
+
+double getTraceTime(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+
+//////////////////////////////
+//
+// addTraceSpan -- Add a span from start to end on the current thread.
+//     The name should be a string constant.  file is the name of the
+//     file being converted (which is copied), or NULL for the spans
+//     inside of the span of a file.  Nothing is done if tracing has
+//     not been started.
+//
+
+void addTraceSpan(const char* name, const char* file, double start,
+		double end) {
+	if (traceLog == NULL) {
+		return;
+	}
+	char* copy = file ? strdup(file) : NULL;
+	pthread_mutex_lock(&traceLog->mutex);
+	if (traceThread == 0) {
+		traceThread = ++traceLog->threads;
+	}
+	if (traceLog->count == traceLog->capacity) {
+		int capacity = traceLog->capacity ? 2 * traceLog->capacity : 1024;
+		TraceSpan* spans = (TraceSpan*)realloc(traceLog->spans,
+				capacity * sizeof(TraceSpan));
+		if (spans == NULL) {
+			// Keep the spans which are already stored.
+			pthread_mutex_unlock(&traceLog->mutex);
+			free(copy);
+			return;
+		}
+		traceLog->spans    = spans;
+		traceLog->capacity = capacity;
+	}
+	TraceSpan* span = &traceLog->spans[traceLog->count++];
+	span->name   = name;
+	span->file   = copy;
+	span->start  = start;
+	span->end    = end;
+	span->thread = traceThread;
+	pthread_mutex_unlock(&traceLog->mutex);
+}
+
+
+
+//////////////////////////////
+//
+// writeTrace -- Write the spans as a Trace Event JSON file, and stop
+//     tracing.  Returns 0 if successful.
+//
+
+int writeTrace(const char* filename) {
+	if (traceLog == NULL) {
+		return 0;
+	}
+	int status = 0;
+	int i;
+	FILE* output = fopen(filename, "w");
+	if (output == NULL) {
+		fprintf(stderr, "Error: cannot open file %s for writing.\n", filename);
+		status = -1;
+	} else {
+		fprintf(output, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(output, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"tid\":0,\"args\":{\"name\":");
+		writeJsonString(output, traceLog->program);
+		fprintf(output, "}}");
+		for (i=1; i<=traceLog->threads; i++) {
+			fprintf(output, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+					"\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+					i, i);
+		}
+		for (i=0; i<traceLog->count; i++) {
+			TraceSpan* span = &traceLog->spans[i];
+			fprintf(output, ",\n{\"name\":");
+			writeJsonString(output, span->name);
+			fprintf(output, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3lf,"
+					"\"dur\":%.3lf,\"pid\":1,\"tid\":%d",
+					span->file ? "file" : "phase",
+					(span->start - traceLog->start) * 1e6,
+					(span->end - span->start) * 1e6, span->thread);
+			if (span->file != NULL) {
+				fprintf(output, ",\"args\":{\"file\":");
+				writeJsonString(output, span->file);
+				fprintf(output, "}");
+			}
+			fprintf(output, "}");
+		}
+		fprintf(output, "\n]}\n");
+		if (fclose(output) != 0) {
+			fprintf(stderr, "Error: cannot write file %s.\n", filename);
+			status = -1;
+		}
+	}
+
+	for (i=0; i<traceLog->count; i++) {
+		free(traceLog->spans[i].file);
+	}
+	free(traceLog->spans);
+	pthread_mutex_destroy(&traceLog->mutex);
+	free(traceLog);
+	traceLog = NULL;
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// writeJsonString -- Write a string in double quotes, with the
+//     characters which JSON does not allow in strings escaped.  Also
+//     used for the JSON output of runstats.c and mus2pmx --info.
+//
+
+void writeJsonString(FILE* output, const char* string) {
+	const unsigned char* ptr;
+	fputc('"', output);
+	for (ptr=(const unsigned char*)string; *ptr; ptr++) {
+		if ((*ptr == '"') || (*ptr == '\\')) {
+			fprintf(output, "\\%c", *ptr);
+		} else if (*ptr < 0x20) {
+			fprintf(output, "\\u%04x", *ptr);
+		} else {
+			fputc(*ptr, output);
+		}
+	}
+	fputc('"', output);
+}
+
+
+
@@ -0,0 +1,29 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:29:08 PDT 2026
+// Last Modified: Thu Oct 15 20:29:08 PDT 2026
+// Filename:      trace.h
+// Syntax:        C
+//
+// Description:   Timeline of a conversion run for the --trace option of
+//                mus2pmx, pmx2mus and drw2aton.  Each file is a span of
+//                time on the thread which converted it, containing spans
+//                for the parts of the conversion.  The timeline is written
+//                in the Trace Event JSON format, which can be loaded into
+//                chrome://tracing or https://ui.perfetto.dev.
+//
+
+#ifndef _TRACE_H_INCLUDED
+#define _TRACE_H_INCLUDED
+
+#include <stdio.h>
+
+void     startTrace      (const char* program);
+int      isTracing       (void);
+double   getTraceTime    (void);
+void     addTraceSpan    (const char* name, const char* file,
+                          double start, double end);
+int      writeTrace      (const char* filename);
+void     writeJsonString (FILE* output, const char* string);
+
+#endif  /* _TRACE_H_INCLUDED */
@@ -0,0 +1,112 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:02:53 PDT 2026
+// Last Modified: Thu Oct 15 20:02:53 PDT 2026
+// Filename:      workpool.c
+// Syntax:        C
+//
+// Description:   Run a list of independent jobs on a pool of threads.
+//                Each thread takes the next unprocessed job index until
+//                all jobs are done, so long jobs do not hold up the
+//                other threads.
+//
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "workpool.h"
+
+typedef struct {
+	WorkFunction    function;
+	void*           context;
+	int             jobCount;
+	int             nextJob;
+	pthread_mutex_t mutex;
+} WorkPool;
+
+// function declarations:
+static void*    runWorker        (void* arg);
+
+
+
+//////////////////////////////
+//
+// getProcessorCount -- Return the number of online processor cores.
+//
+
+int getProcessorCount(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+
+
+//////////////////////////////
+//
+// runWorkPool -- Call function(context, index) for each job index
+//    using up to threadCount threads, and return when all jobs are
+//    finished.  The jobs are run in the calling thread if there is
+//    only one thread (or if threads cannot be created).
+//
+
+void runWorkPool(int threadCount, int jobCount, WorkFunction function,
+		void* context) {
+	WorkPool pool;
+	pool.function = function;
+	pool.context  = context;
+	pool.jobCount = jobCount;
+	pool.nextJob  = 0;
+	pthread_mutex_init(&pool.mutex, NULL);
+
+	if (threadCount > jobCount) {
+		threadCount = jobCount;
+	}
+	pthread_t* threads = NULL;
+	int started = 0;
+	if (threadCount > 1) {
+		threads = (pthread_t*)malloc((threadCount - 1) * sizeof(pthread_t));
+		while ((threads != NULL) && (started < threadCount - 1)) {
+			if (pthread_create(&threads[started], NULL, runWorker, &pool) != 0) {
+				break;
+			}
+			started++;
+		}
+	}
+
+	// The calling thread also processes jobs, which covers the case
+	// where no threads could be started.
+	runWorker(&pool);
+
+	int i;
+	for (i=0; i<started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&pool.mutex);
+}
+
+
+
+//////////////////////////////
+//
+// runWorker -- Process jobs until there are none left.
+//
+
+static void* runWorker(void* arg) {
+	WorkPool* pool = (WorkPool*)arg;
+	int job;
+	while (1) {
+		pthread_mutex_lock(&pool->mutex);
+		job = pool->nextJob++;
+		pthread_mutex_unlock(&pool->mutex);
+		if (job >= pool->jobCount) {
+			break;
+		}
+		pool->function(pool->context, job);
+	}
+	return NULL;
+}
+
+
+
@@ -0,0 +1,21 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Thu Oct 15 20:02:53 PDT 2026
+// Last Modified: Thu Oct 15 20:02:53 PDT 2026
+// Filename:      workpool.h
+// Syntax:        C
+//
+// Description:   Run a list of independent jobs on a pool of threads.
+//
+
+#ifndef _WORKPOOL_H_INCLUDED
+#define _WORKPOOL_H_INCLUDED
+
+// Called once for each job index from 0 to jobCount-1:
+typedef void (*WorkFunction)(void* context, int index);
+
+int      getProcessorCount    (void);
+void     runWorkPool          (int threadCount, int jobCount,
+                               WorkFunction function, void* context);
+
+#endif  /* _WORKPOOL_H_INCLUDED */